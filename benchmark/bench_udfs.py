@@ -0,0 +1,92 @@
+"""Python sources used by the pytables_benchmark driver."""
+import datetime
+import decimal
+import uuid
+from typing import Iterator, Tuple
+
+
+def strings(num_rows, num_columns):
+    """Yields rows of distinct short strings"""
+    num_columns = int(num_columns)
+    for i in range(int(num_rows)):
+        value = str(i)
+        yield tuple(value for _ in range(num_columns))
+
+
+def categories(num_rows, num_categories, fresh):
+    """
+    Yields rows of a few repeated strings, like region names or status codes. With 'fresh' each
+    value is a new but equal str, as when parsed out of an API response.
+    """
+    names = [f"category-{c}" for c in range(int(num_categories))]
+    for i in range(int(num_rows)):
+        name = names[i % len(names)]
+        yield ((name + '.')[:-1] if fresh else name,)
+
+
+def integers(num_rows, num_columns):
+    """Yields rows of integers"""
+    num_columns = int(num_columns)
+    for i in range(int(num_rows)):
+        yield tuple(i + c for c in range(num_columns))
+
+
+def annotated_integers(num_rows) -> Iterator[Tuple[int, int, int, int]]:
+    """Same rows as integers(num_rows, 4), with the schema coming from the annotation"""
+    for i in range(int(num_rows)):
+        yield (i, i + 1, i + 2, i + 3)
+
+
+def shaped(num_rows, num_columns, shape):
+    """Rows of integers as tuples, lists, or generators, to compare the cost of each row shape"""
+    num_columns = int(num_columns)
+    columns = range(num_columns)
+    if shape == 'tuple':
+        for i in range(int(num_rows)):
+            yield tuple(i + c for c in columns)
+    elif shape == 'list':
+        for i in range(int(num_rows)):
+            yield [i + c for c in columns]
+    elif shape == 'generator':
+        for i in range(int(num_rows)):
+            yield (i + c for c in columns)
+    else:
+        raise ValueError(f"Unknown row shape: {shape}")
+
+
+# A few values of each DuckDB type the extension converts, keyed by the type's name
+_TYPED_VALUES = {
+    'BOOLEAN': [True, False],
+    'INTEGER': [1, -2, 3],
+    'BIGINT': [2 ** 40, -5],
+    'HUGEINT': [2 ** 100, -(2 ** 90)],
+    'DOUBLE': [1.5, -2.25],
+    'DECIMAL(18,3)': [decimal.Decimal('1.250'), decimal.Decimal('-3.5')],
+    'VARCHAR': ['duck', 'goose'],
+    'BLOB': [b'\x00\x01', b'duck'],
+    'UUID': [uuid.UUID('6f1d9f2c-2a4e-4c1a-9d3b-0c5b1e7f8a90')],
+    'DATE': [datetime.date(2023, 1, 2)],
+    'TIME': [datetime.time(3, 4, 5)],
+    'TIMESTAMP': [datetime.datetime(2023, 1, 2, 3, 4, 5)],
+    'TIMESTAMPTZ': [datetime.datetime(2023, 1, 2, 3, 4, 5, tzinfo=datetime.timezone.utc)],
+    'INTERVAL': [datetime.timedelta(days=1, seconds=5)],
+    'BIGINT[]': [[1, 2, 3], []],
+    'STRUCT(a BIGINT, b VARCHAR)': [{'a': 1, 'b': 'x'}],
+    'MAP(VARCHAR, BIGINT)': [{'a': 1, 'b': 2}],
+}
+
+
+def typed(num_rows, type_name):
+    """Single column rows cycling through sample values of the given DuckDB type"""
+    values = _TYPED_VALUES[type_name]
+    rows = [(v,) for v in values]
+    for i in range(int(num_rows)):
+        yield rows[i % len(rows)]
+
+
+def identity(value):
+    return value
+
+
+def count_args(*args):
+    return str(len(args))
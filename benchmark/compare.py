@@ -0,0 +1,53 @@
+"""
+Compares two JSON results files from pytables_benchmark, eg
+
+    pytables_benchmark --format json > baseline.json
+    # ...make changes, rebuild...
+    pytables_benchmark --format json > current.json
+    python benchmark/compare.py baseline.json current.json
+
+Exits non-zero if any benchmark's throughput dropped by more than the threshold.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as results_file:
+        results = json.load(results_file)
+    return {r['benchmark']: r for r in results['results']}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--threshold', type=float, default=0.10,
+                        help='Fractional drop in rows/second that counts as a regression (default 0.10)')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    regressions = []
+    print(f"{'benchmark':40} {'baseline rows/s':>16} {'current rows/s':>16} {'change':>8}")
+    for name in sorted(baseline.keys() & current.keys()):
+        before = baseline[name]['rows_per_second']
+        after = current[name]['rows_per_second']
+        change = (after - before) / before if before else 0.0
+        flag = ''
+        if change < -args.threshold:
+            regressions.append(name)
+            flag = '  REGRESSION'
+        print(f"{name:40} {before:>16} {after:>16} {change:>+8.1%}{flag}")
+    for name in sorted(baseline.keys() - current.keys()):
+        print(f"{name:40} missing from current results")
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) regressed by more than {args.threshold:.0%}")
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
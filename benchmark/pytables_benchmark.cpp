@@ -0,0 +1,213 @@
+// Throughput benchmark for the pytables extension. Built when PYTABLES_BUILD_BENCHMARK is on,
+// and expects the benchmark/ directory to be on the PYTHONPATH (see 'make benchmark').
+//
+// Results are written as CSV (the default) or JSON, to stdout or --output. benchmark/compare.py
+// diffs two JSON results files to catch regressions.
+#include "duckdb.hpp"
+#include "pytables_extension.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace duckdb;
+
+#ifdef Py_LIMITED_API
+static const char *BUILD_VARIANT = "limited";
+#else
+static const char *BUILD_VARIANT = "native";
+#endif
+
+struct BenchmarkCase {
+	std::string name;
+	// Number of rows the query produces or processes, used to report throughput
+	idx_t rows;
+	std::string query;
+};
+
+struct BenchmarkResult {
+	std::string name;
+	idx_t rows;
+	// Sorted wall clock seconds of each repetition
+	std::vector<double> timings;
+
+	double Median() const {
+		return timings[timings.size() / 2];
+	}
+};
+
+// A 'columns' argument with 'count' columns of the same type, named a, b, c...
+static std::string Columns(idx_t count, const std::string &type) {
+	std::string columns = "{";
+	for (idx_t i = 0; i < count; i++) {
+		columns += (i ? ", '" : "'") + std::string(1, (char)('a' + i)) + "': '" + type + "'";
+	}
+	return columns + "}";
+}
+
+static std::vector<BenchmarkCase> GetBenchmarkCases() {
+	std::vector<BenchmarkCase> cases = {
+	    // Schema width
+	    {"pytable_varchar_narrow", 1000000,
+	     "SELECT count(*) FROM pytable('bench_udfs:strings', 1000000, 1, columns = " + Columns(1, "VARCHAR") + ")"},
+	    {"pytable_varchar_wide", 100000,
+	     "SELECT count(*) FROM pytable('bench_udfs:strings', 100000, 10, columns = " + Columns(10, "VARCHAR") + ")"},
+	    // Low cardinality strings, repeating the same objects or equal ones
+	    {"pytable_varchar_repeated", 1000000,
+	     "SELECT count(*) FROM pytable('bench_udfs:categories', 1000000, 8, false, columns = " +
+	         Columns(1, "VARCHAR") + ")"},
+	    {"pytable_varchar_repeated_equal", 1000000,
+	     "SELECT count(*) FROM pytable('bench_udfs:categories', 1000000, 8, true, columns = " +
+	         Columns(1, "VARCHAR") + ")"},
+	    {"pytable_varchar_repeated_group", 1000000,
+	     "SELECT a, count(*) FROM pytable('bench_udfs:categories', 1000000, 8, false, columns = " +
+	         Columns(1, "VARCHAR") + ") GROUP BY a"},
+	    {"pytable_bigint", 1000000,
+	     "SELECT count(*) FROM pytable('bench_udfs:integers', 1000000, 4, columns = " + Columns(4, "BIGINT") + ")"},
+	    // Where the schema comes from
+	    {"pytable_schema_annotated", 1000000, "SELECT count(*) FROM pytable('bench_udfs:annotated_integers', 1000000)"},
+	    {"pytable_schema_detected", 1000000, "SELECT count(*) FROM pytable('bench_udfs:integers', 1000000, 4)"},
+	    // pycall, with the function given as a constant or a column, and varying numbers of arguments
+	    {"pycall_varchar", 100000, "SELECT count(pycall('bench_udfs:identity', i::VARCHAR)) FROM range(100000) t(i)"},
+	    {"pycall_column_specifier", 100000,
+	     "SELECT count(pycall(f, i::VARCHAR)) FROM (SELECT 'bench_udfs:identity' AS f, i FROM range(100000) t(i))"},
+	    {"pycall_args_1", 100000, "SELECT sum(pycall('bench_udfs:count_args', i)::INT) FROM range(100000) t(i)"},
+	    {"pycall_args_4", 100000,
+	     "SELECT sum(pycall('bench_udfs:count_args', i, i, i, i)::INT) FROM range(100000) t(i)"},
+	    {"pycall_args_8", 100000,
+	     "SELECT sum(pycall('bench_udfs:count_args', i, i, i, i, i, i, i, i)::INT) FROM range(100000) t(i)"},
+	    // Argument values that repeat, which are converted once per chunk
+	    {"pycall_varchar_repeated", 100000,
+	     "SELECT count(pycall('bench_udfs:identity', 'category number ' || (i % 8)::VARCHAR)) FROM range(100000) t(i)"},
+	    {"pycall_date_repeated", 100000,
+	     "SELECT count(pycall('bench_udfs:identity', DATE '2023-01-01' + (i % 30)::INT)) FROM range(100000) t(i)"},
+	    {"pycall_struct", 100000,
+	     "SELECT count(pycall('bench_udfs:identity', {'a': i, 'b': 'x'})) FROM range(100000) t(i)"},
+	};
+
+	// Row shapes, the same integers yielded as tuples, lists, and generators
+	for (auto shape : {"tuple", "list", "generator"}) {
+		cases.push_back({std::string("pytable_rows_") + shape, 1000000,
+		                 "SELECT count(*) FROM pytable('bench_udfs:shaped', 1000000, 4, '" + std::string(shape) +
+		                     "', columns = " + Columns(4, "BIGINT") + ")"});
+	}
+
+	// Every type the extension converts, see _TYPED_VALUES in bench_udfs.py
+	std::vector<std::pair<std::string, std::string>> types = {
+	    {"boolean", "BOOLEAN"},
+	    {"integer", "INTEGER"},
+	    {"bigint", "BIGINT"},
+	    {"hugeint", "HUGEINT"},
+	    {"double", "DOUBLE"},
+	    {"decimal", "DECIMAL(18,3)"},
+	    {"varchar", "VARCHAR"},
+	    {"blob", "BLOB"},
+	    {"uuid", "UUID"},
+	    {"date", "DATE"},
+	    {"time", "TIME"},
+	    {"timestamp", "TIMESTAMP"},
+	    {"timestamptz", "TIMESTAMPTZ"},
+	    {"interval", "INTERVAL"},
+	    {"list", "BIGINT[]"},
+	    {"struct", "STRUCT(a BIGINT, b VARCHAR)"},
+	    {"map", "MAP(VARCHAR, BIGINT)"},
+	};
+	for (auto &type : types) {
+		cases.push_back({"pytable_type_" + type.first, 500000,
+		                 "SELECT count(*) FROM pytable('bench_udfs:typed', 500000, '" + type.second +
+		                     "', columns = " + Columns(1, type.second) + ")"});
+	}
+	return cases;
+}
+
+static void WriteCSV(const std::vector<BenchmarkResult> &results, std::ostream &out) {
+	out << "variant,benchmark,rows,median_seconds,min_seconds,max_seconds,rows_per_second" << std::endl;
+	for (auto &result : results) {
+		out << BUILD_VARIANT << "," << result.name << "," << result.rows << "," << result.Median() << ","
+		    << result.timings.front() << "," << result.timings.back() << "," << (idx_t)(result.rows / result.Median())
+		    << std::endl;
+	}
+}
+
+static void WriteJSON(const std::vector<BenchmarkResult> &results, std::ostream &out) {
+	out << "{\"variant\": \"" << BUILD_VARIANT << "\", \"results\": [";
+	for (idx_t i = 0; i < results.size(); i++) {
+		auto &result = results[i];
+		out << (i ? ",\n  " : "\n  ") << "{\"benchmark\": \"" << result.name << "\", \"rows\": " << result.rows
+		    << ", \"repetitions\": " << result.timings.size() << ", \"median_seconds\": " << result.Median()
+		    << ", \"min_seconds\": " << result.timings.front() << ", \"max_seconds\": " << result.timings.back()
+		    << ", \"rows_per_second\": " << (idx_t)(result.rows / result.Median()) << "}";
+	}
+	out << "\n]}" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	idx_t repetitions = 5;
+	std::string filter;
+	std::string format = "csv";
+	std::string output_path;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--repetitions" && i + 1 < argc) {
+			repetitions = std::stoul(argv[++i]);
+		} else if (arg == "--filter" && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (arg == "--format" && i + 1 < argc && (std::string(argv[i + 1]) == "csv" ||
+		                                                 std::string(argv[i + 1]) == "json")) {
+			format = argv[++i];
+		} else if (arg == "--output" && i + 1 < argc) {
+			output_path = argv[++i];
+		} else {
+			std::cerr << "Usage: " << argv[0]
+			          << " [--repetitions N] [--filter SUBSTRING] [--format csv|json] [--output FILE]" << std::endl;
+			return 1;
+		}
+	}
+	if (repetitions < 1) {
+		std::cerr << "--repetitions must be at least 1" << std::endl;
+		return 1;
+	}
+
+	DuckDB db(nullptr);
+	db.LoadExtension<PytablesExtension>();
+	Connection con(db);
+
+	std::vector<BenchmarkResult> results;
+	for (auto &benchmark : GetBenchmarkCases()) {
+		if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) {
+			continue;
+		}
+		BenchmarkResult result {benchmark.name, benchmark.rows, {}};
+		for (idx_t rep = 0; rep < repetitions; rep++) {
+			auto start = std::chrono::steady_clock::now();
+			auto query_result = con.Query(benchmark.query);
+			auto end = std::chrono::steady_clock::now();
+			if (query_result->HasError()) {
+				std::cerr << benchmark.name << " failed: " << query_result->GetError() << std::endl;
+				return 1;
+			}
+			result.timings.push_back(std::chrono::duration<double>(end - start).count());
+		}
+		std::sort(result.timings.begin(), result.timings.end());
+		results.push_back(std::move(result));
+	}
+
+	std::ofstream output_file;
+	if (!output_path.empty()) {
+		output_file.open(output_path);
+		if (!output_file.is_open()) {
+			std::cerr << "Failed to open " << output_path << std::endl;
+			return 1;
+		}
+	}
+	auto &out = output_path.empty() ? std::cout : output_file;
+	if (format == "json") {
+		WriteJSON(results, out);
+	} else {
+		WriteCSV(results, out);
+	}
+	return 0;
+}
@@ -1,38 +1,228 @@
-
+import collections.abc
+import dataclasses
+import datetime
+import decimal
 import inspect
+import typing
+import uuid
 from typing import Any, Optional, Dict, Iterable
 
+# Python types with a direct DuckDB counterpart
+_DUCKDB_TYPES = {
+    bool: 'BOOLEAN',
+    int: 'BIGINT',
+    float: 'DOUBLE',
+    str: 'VARCHAR',
+    bytes: 'BLOB',
+    bytearray: 'BLOB',
+    datetime.date: 'DATE',
+    datetime.datetime: 'TIMESTAMP',
+    datetime.time: 'TIME',
+    datetime.timedelta: 'INTERVAL',
+    decimal.Decimal: 'DECIMAL(18, 3)',
+    uuid.UUID: 'UUID',
+}
+
+
+def row_fields(row_type):
+    """
+    Returns a list of (name, annotation) pairs for dataclass, NamedTuple, and TypedDict
+    row types, or None for anything else.
+    """
+    if not isinstance(row_type, type):
+        return None
+    if dataclasses.is_dataclass(row_type):
+        hints = typing.get_type_hints(row_type)
+        return [(f.name, hints.get(f.name, f.type)) for f in dataclasses.fields(row_type)]
+    if issubclass(row_type, tuple) and hasattr(row_type, '_fields'):
+        hints = typing.get_type_hints(row_type)
+        return [(name, hints.get(name, Any)) for name in row_type._fields]
+    if issubclass(row_type, dict) and hasattr(row_type, '__total__'):
+        return list(typing.get_type_hints(row_type).items())
+    return None
+
+
+def duckdb_type(annotation):
+    """
+    Translates a type annotation to a DuckDB type, eg List[int] becomes 'BIGINT[]'. Returns
+    None if there is no equivalent.
+    """
+    if annotation in _DUCKDB_TYPES:
+        return _DUCKDB_TYPES[annotation]
+
+    fields = row_fields(annotation)
+    if fields is not None:
+        children = []
+        for name, field_annotation in fields:
+            child = duckdb_type(field_annotation)
+            if child is None:
+                return None
+            escaped = name.replace('"', '""')
+            children.append(f'"{escaped}" {child}')
+        return f"STRUCT({', '.join(children)})"
+
+    origin = typing.get_origin(annotation)
+    args = typing.get_args(annotation)
+    if origin is typing.Union:
+        # Optional[X] is just X, since any column may hold a NULL
+        non_null = [a for a in args if a is not type(None)]
+        return duckdb_type(non_null[0]) if len(non_null) == 1 else None
+    if origin is None or not args:
+        return None
+    if not isinstance(origin, type):
+        return None
+    if issubclass(origin, collections.abc.Mapping):
+        key, value = duckdb_type(args[0]), duckdb_type(args[1])
+        return f'MAP({key}, {value})' if key and value else None
+    if origin is tuple:
+        # Only homogeneous tuples, ie Tuple[int, ...], map to a list
+        if len(args) == 2 and args[1] is Ellipsis:
+            child = duckdb_type(args[0])
+            return f'{child}[]' if child else None
+        return None
+    if issubclass(origin, collections.abc.Iterable):
+        child = duckdb_type(args[0])
+        return f'{child}[]' if child else None
+    return None
+
+
 class DuckTableSchemaWrapper:
 
     def __init__(self, func):
         self.func = func
 
+    def _row_type(self):
+        sig = inspect.signature(self.func)
+        return_type = sig.return_annotation
+        if sig.return_annotation == inspect.Signature.empty:
+            return None
+
+        # First level which represents the table, async generators yield the rows of theirs
+        if hasattr(return_type, '__origin__') and issubclass(
+                return_type.__origin__, (collections.abc.Iterable, collections.abc.AsyncIterable)):
+            return return_type.__args__[0]
+        return None
+
     def column_names(self, *args, **kwargs):
+        fields = row_fields(self._row_type())
+        if fields is not None:
+            return [name for name, _ in fields]
         col_types = self.column_types(*args, **kwargs)
         if not col_types:
             return None
         return [f'column{i + 1}' for i in range(len(col_types))]
 
     def column_types(self, *args, **kwargs):
-        sig = inspect.signature(self.func)
-        return_type = sig.return_annotation
-        if sig.return_annotation == inspect.Signature.empty:
+        row_type = self._row_type()
+        if row_type is None:
             return None
 
-        # First level which represents the table
-        if hasattr(return_type, '__origin__') and issubclass(return_type.__origin__, Iterable):
-            row_type = return_type.__args__[0]
+        # Rows described by a dataclass, NamedTuple, or TypedDict
+        fields = row_fields(row_type)
+        if fields is not None:
+            return [annotation for _, annotation in fields]
 
-            # Second level which represents a row
-            if hasattr(row_type, '__origin__') and issubclass(row_type.__origin__, Iterable):
-                col_types = row_type.__args__  # Column types
-                return list(col_types)
-                # return {f'column{i + 1}': typ for i, typ in enumerate(col_types)}
+        # Second level which represents a row
+        if hasattr(row_type, '__origin__') and issubclass(row_type.__origin__, Iterable):
+            col_types = row_type.__args__  # Column types
+            return list(col_types)
+            # return {f'column{i + 1}': typ for i, typ in enumerate(col_types)}
         return None
 
+    def column_duckdb_types(self, *args, **kwargs):
+        """The DuckDB type of each column, or None if any column has no DuckDB equivalent"""
+        col_types = self.column_types(*args, **kwargs)
+        if not col_types:
+            return None
+        duckdb_types = [duckdb_type(t) for t in col_types]
+        if None in duckdb_types:
+            return None
+        return duckdb_types
+
     def __call__(self, *args, **kwargs):
         return self.func(*args, **kwargs)
 
 def ducktable(func):
     return DuckTableSchemaWrapper(func)
 
+
+class ScalarUDF:
+    """
+    Base class for scalar functions with expensive setup, such as loading a model or compiling a
+    regex. Pass the class to pycall() or pytables_register() and each DuckDB thread creates its own
+    instance, calls setup() once, calls the instance for every row, and calls teardown() when it is
+    done. Define process_batch() instead of __call__ to receive a whole chunk at once, as one list
+    per argument, returning a list with a result for each row.
+    """
+
+    def setup(self):
+        pass
+
+    def teardown(self):
+        pass
+
+    def __call__(self, *args):
+        raise NotImplementedError(f"{type(self).__name__} must define __call__ or process_batch")
+
+
+class Sink:
+    """
+    Base class for receiving query results from COPY (query) TO 'module:Class' (FORMAT python).
+    Each DuckDB thread writing results creates its own instance, calls setup() once, write(batch)
+    for each batch of rows, and flush() when the thread has written its share. finalize() is
+    called once on the class after every thread has flushed. A batch is a dict mapping each
+    column name to a list of its values, or a pyarrow.Table with BATCH_FORMAT 'arrow'.
+    """
+
+    def setup(self):
+        pass
+
+    def write(self, batch):
+        raise NotImplementedError(f"{type(self).__name__} must define write")
+
+    def flush(self):
+        pass
+
+    @classmethod
+    def finalize(cls):
+        pass
+
+
+def deterministic(func):
+    """
+    Declares that func always returns the same result for the same arguments and has no side
+    effects. DuckDB may then evaluate pycall() on constant arguments once while planning, and
+    share the result of identical calls within a query. This is the default for undecorated
+    functions.
+    """
+    func.__ducktables_deterministic__ = True
+    return func
+
+
+def volatile(func):
+    """
+    Declares that func may return different results for the same arguments, or has side effects,
+    so every pycall() runs it.
+    """
+    func.__ducktables_deterministic__ = False
+    return func
+
+
+class Cursor:
+    """
+    Yield one from a table function called with pytable(..., cursor := 'name') to record how far
+    it got, such as the last ContinuationToken or the newest timestamp it returned. It isn't a
+    row. Once the function finishes, the last cursor it yielded is saved as JSON in the
+    pytables_cursors table, in the same transaction as the query, and passed back as the
+    'cursor' keyword argument on the next run. The first run receives None.
+    """
+
+    def __init__(self, value):
+        self.__ducktables_cursor__ = value
+
+    @property
+    def value(self):
+        return self.__ducktables_cursor__
+
+    def __repr__(self):
+        return f'Cursor({self.value!r})'
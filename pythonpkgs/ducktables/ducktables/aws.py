@@ -1,6 +1,14 @@
 
+import datetime
+import queue
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from typing import Iterator, NamedTuple
+
 import boto3
 
+from ducktables import Cursor, ducktable
+
 
 def ec2_instances():
     """
@@ -71,45 +79,140 @@ def s3_buckets():
         yield (bucket['Name'], bucket['CreationDate'].strftime('%m/%d/%Y'))
     
 
-def s3_objects(bucket, prefix = None):
+class S3Object(NamedTuple):
+    key: str
+    last_modified: datetime.datetime
+    size: int
+    storage_class: str
+
+
+# Pages of listing results each thread may get ahead of the consumer by
+_PAGES_PER_THREAD = 4
+# How often a thread waiting on the queue checks whether the listing was abandoned, and lets
+# a cancelled query interrupt the consumer
+_POLL_SECONDS = 0.1
+# Marks the end of a prefix's pages in the queue
+_DONE = object()
+
+
+def _pages(client, list_args, prefix, **extra):
+    """The 'Contents' and 'CommonPrefixes' of each page listing objects under prefix"""
+    args = dict(list_args, **extra)
+    # list_objects_v2 won't take a None prefix, only set it when there is one
+    if prefix:
+        args['Prefix'] = prefix
+    for page in client.get_paginator('list_objects_v2').paginate(**args):
+        yield page.get('Contents', []), page.get('CommonPrefixes', [])
+
+
+def _put(results, item, stop):
+    while not stop.is_set():
+        try:
+            results.put(item, timeout=_POLL_SECONDS)
+            return
+        except queue.Full:
+            pass
+
+
+def _get(results):
+    while True:
+        try:
+            return results.get(timeout=_POLL_SECONDS)
+        except queue.Empty:
+            pass
+
+
+def _list_concurrently(client, list_args, prefix, delimiter, concurrency, max_depth=2):
+    """
+    Lists every object under prefix on a pool of threads, yielding pages as they arrive. Each
+    listing of a level, one delimiter deep, queues its common prefixes as listings of their own
+    as soon as it finishes. Those are listed a level at a time too, until a level has enough
+    prefixes to keep every thread busy or is max_depth deep, then each is listed in one pass.
+    """
+    results = queue.Queue(maxsize=concurrency * _PAGES_PER_THREAD)
+    stop = threading.Event()
+    executor = ThreadPoolExecutor(max_workers=concurrency, thread_name_prefix='s3_objects')
+    lock = threading.Lock()
+    # Listings queued or running, counted before they're submitted so it only reaches zero at the end
+    outstanding = [0]
+
+    def submit(level, depth):
+        with lock:
+            outstanding[0] += 1
+        executor.submit(list_prefix, level, depth)
+
+    def list_prefix(level, depth):
+        try:
+            split = delimiter and depth < max_depth
+            extra = {'Delimiter': delimiter} if split else {}
+            deeper = []
+            for contents, common_prefixes in _pages(client, list_args, level, **extra):
+                if stop.is_set():
+                    return
+                _put(results, contents, stop)
+                deeper.extend(p['Prefix'] for p in common_prefixes)
+            next_depth = depth + 1 if len(deeper) < concurrency else max_depth
+            for child in deeper:
+                submit(child, next_depth)
+        except Exception as e:
+            _put(results, e, stop)
+        finally:
+            _put(results, _DONE, stop)
+
+    try:
+        submit(prefix, 0 if concurrency > 1 else max_depth)
+        while True:
+            item = _get(results)
+            if item is _DONE:
+                with lock:
+                    outstanding[0] -= 1
+                    if not outstanding[0]:
+                        return
+            elif isinstance(item, Exception):
+                raise item
+            else:
+                yield item
+    finally:
+        # Also reached when the query stops early, the threads give up at their next page
+        stop.set()
+        executor.shutdown(wait=False)
+
+
+@ducktable
+def s3_objects(bucket, prefix=None, cursor=None, concurrency=8, delimiter='/',
+               endpoint_url=None) -> Iterator[S3Object]:
     """
     SQL Usage:
-    SELECT * FROM pytable('aws:s3_objects', 'bucket-name', 'foo/bar/prefix',
-      columns = { 'key': 'VARCHAR', 'last_modified': 'VARCHAR', 'size': 'INT', 'storage_class': 'VARCHAR'}
-    );
+    SELECT * FROM pytable('aws:s3_objects', 'bucket-name', 'foo/bar/prefix');
 
     Note that the final prefix argument is optional, and you don't need to specify it in
     your SQL query. To list all objects:
-    SELECT * FROM python_table('aws', 's3_objects',
-      { 'key': 'VARCHAR', 'last_modified': 'VARCHAR', 'size': 'INT', 'storage_class': 'VARCHAR'},
-      ['bucket-name']);
+    SELECT * FROM pytable('aws:s3_objects', 'bucket-name');
+
+    The keyspace is split at each delimiter into prefixes that are listed on `concurrency`
+    threads at once, so rows come back in no particular order. Pass concurrency := 1 to list
+    the bucket in a single sequential pass, or point endpoint_url at an S3 compatible server
+    such as MinIO:
+    SELECT * FROM pytable('aws:s3_objects', 'bucket-name',
+      kwargs = {'concurrency': 16, 'endpoint_url': 'http://localhost:9000'});
+
+    To only list objects added since the last run, for buckets whose new keys sort after
+    the old ones (such as date prefixed logs), name a cursor. The greatest key listed is
+    saved, and the next run starts after it:
+    INSERT INTO objects SELECT * FROM pytable('aws:s3_objects', 'bucket-name', cursor = 'logs');
     """
-    def to_row(obj):
-        return (obj['Key'],
-                obj['LastModified'].strftime('%m/%d/%Y'),
-                obj['Size'],
-                obj['StorageClass'])
-
-    # Note that the list_objects_v2 doesn't let you specify a meaningless
-    # Prefix value. So we can't just pass in a None. We have to check if
-    # a value was specified, and only use it as an argument if one exists.
-    kwargs = {
-        'Bucket': bucket
-        }
-    if prefix:
-        kwargs['Prefix']=prefix
+    client = boto3.client('s3', endpoint_url=endpoint_url)
+    list_args = {'Bucket': bucket}
+    if cursor:
+        list_args['StartAfter'] = cursor
 
-        
-    client = boto3.client('s3')
-    response = client.list_objects_v2(**kwargs)
-    for obj in response.get('Contents', []):
-        yield to_row(obj)
-
-    while response['IsTruncated']:
-        # Continue to make additional requests, this happens because each
-        # list objects request is capped at 1000 responses.
-        kwargs['ContinuationToken'] = response['NextContinuationToken']
-        response = client.list_objects_v2(**kwargs)
-        for obj in response['Contents']:
-            yield to_row(obj)
-        
+    concurrency = max(1, int(concurrency))
+    last_key = None
+    for contents in _list_concurrently(client, list_args, prefix, delimiter, concurrency):
+        for obj in contents:
+            if last_key is None or obj['Key'] > last_key:
+                last_key = obj['Key']
+            yield S3Object(obj['Key'], obj['LastModified'], obj['Size'], obj.get('StorageClass'))
+
+    if last_key is not None:
+        yield Cursor(last_key)
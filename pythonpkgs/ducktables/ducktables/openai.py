@@ -1,11 +1,29 @@
 
 
+import concurrent.futures
+import hashlib
+import json
 import os, sys
+import sqlite3
+import threading
+import time
+from typing import Iterator, NamedTuple
+
 import openai
 
+from ducktables import ScalarUDF, ducktable
+
 openai.organization = os.getenv("OPENAI_ORG_ID")
 openai.api_key = os.getenv("OPENAI_API_KEY")
 
+DEFAULT_MODEL = "gpt-3.5-turbo"
+# Where responses are cached, an empty string disables the cache
+DEFAULT_CACHE_PATH = os.getenv(
+    "DUCKTABLES_OPENAI_CACHE", os.path.join(os.path.expanduser("~"), ".cache", "ducktables", "openai.sqlite3"))
+
+# How often a thread waiting on responses checks in, so a cancelled query can interrupt it
+_POLL_SECONDS = 0.1
+
 def prompt(input_phrase, num_responses = 5):
     """
     SQL Usage:
@@ -29,6 +47,191 @@ def prompt(input_phrase, num_responses = 5):
             choice['finish_reason'],
             )
 
+
+class ResponseCache:
+    """
+    Responses kept on disk in SQLite, keyed by a hash of the endpoint along with the model,
+    prompt, and parameters of the request, so asking again costs nothing. Each thread needs
+    its own.
+    """
+
+    def __init__(self, path):
+        directory = os.path.dirname(path)
+        if directory:
+            os.makedirs(directory, exist_ok=True)
+        # Other threads and processes may be writing to the same file
+        self.db = sqlite3.connect(path, timeout=30)
+        self.db.execute("CREATE TABLE IF NOT EXISTS responses (key TEXT PRIMARY KEY, response TEXT NOT NULL)")
+
+    @staticmethod
+    def key(request, api_base):
+        # Proxies, Azure deployments, and mocks may answer differently, so keep them apart
+        keyed = {"api_base": (api_base or openai.api_base).rstrip("/"), "request": request}
+        return hashlib.sha256(json.dumps(keyed, sort_keys=True).encode()).hexdigest()
+
+    def get_many(self, keys):
+        found = {}
+        keys = list(keys)
+        # Stay well under SQLite's limit on query parameters
+        for start in range(0, len(keys), 500):
+            chunk = keys[start:start + 500]
+            placeholders = ", ".join("?" * len(chunk))
+            for key, response in self.db.execute(
+                    f"SELECT key, response FROM responses WHERE key IN ({placeholders})", chunk):
+                found[key] = json.loads(response)
+        return found
+
+    def put(self, key, response):
+        with self.db:
+            self.db.execute("INSERT OR REPLACE INTO responses VALUES (?, ?)", (key, json.dumps(response)))
+
+    def close(self):
+        self.db.close()
+
+
+def chat_request(model, input_phrase, num_responses=1, temperature=None):
+    """The parameters of a ChatCompletion request for a single user message"""
+    request = {
+        "model": model,
+        "messages": [{"role": "user", "content": input_phrase}],
+        # Complains when getting int like things so we explicitly cast
+        "n": int(num_responses),
+    }
+    if temperature is not None:
+        request["temperature"] = float(temperature)
+    return request
+
+
+# Thread pools shared by every caller with the same limit, so the limit holds across DuckDB's
+# threads rather than multiplying with them
+_executors = {}
+_executors_lock = threading.Lock()
+
+def _executor(concurrency):
+    with _executors_lock:
+        if concurrency not in _executors:
+            _executors[concurrency] = concurrent.futures.ThreadPoolExecutor(
+                max_workers=concurrency, thread_name_prefix="ducktables.openai")
+        return _executors[concurrency]
+
+
+def _create(request, api_base, retries):
+    """Sends a request, retrying with backoff when rate limited or the service is unavailable"""
+    transient = (openai.error.RateLimitError, openai.error.APIConnectionError,
+                 openai.error.ServiceUnavailableError, openai.error.Timeout)
+    for attempt in range(retries + 1):
+        try:
+            if api_base:
+                completion = openai.ChatCompletion.create(api_base=api_base, **request)
+            else:
+                completion = openai.ChatCompletion.create(**request)
+            return [{
+                "index": choice["index"],
+                "message": choice["message"]["content"],
+                "message_role": choice["message"]["role"],
+                "finish_reason": choice["finish_reason"],
+            } for choice in completion["choices"]]
+        except transient:
+            if attempt == retries:
+                raise
+            time.sleep(2 ** attempt)
+
+
+def complete_all(requests, concurrency=8, cache=None, api_base=None, retries=3):
+    """
+    Sends each request, with up to `concurrency` in flight at once, and returns a list of the
+    choices for each in the same order. Requests that are None get None. Identical requests are
+    only sent once, and those in the cache aren't sent at all.
+    """
+    keys = [None if request is None else ResponseCache.key(request, api_base) for request in requests]
+    unique = {key: request for key, request in zip(keys, requests) if request is not None}
+    responses = cache.get_many(unique.keys()) if cache else {}
+
+    executor = _executor(int(concurrency))
+    pending = {executor.submit(_create, request, api_base, retries): key
+               for key, request in unique.items() if key not in responses}
+    try:
+        while pending:
+            done, _ = concurrent.futures.wait(
+                pending, timeout=_POLL_SECONDS, return_when=concurrent.futures.FIRST_COMPLETED)
+            for future in done:
+                key = pending.pop(future)
+                responses[key] = future.result()
+                # Saved as they arrive, so a failure later on doesn't lose them
+                if cache:
+                    cache.put(key, responses[key])
+    finally:
+        for future in pending:
+            future.cancel()
+    return [None if key is None else responses[key] for key in keys]
+
+
+class ChatPrompt(ScalarUDF):
+    """
+    Answers a prompt for every row, sending the prompts of each chunk of rows concurrently and
+    caching the responses on disk. Subclass it to change the model and settings.
+
+    SQL Usage:
+    SELECT question, pycall('ducktables.openai:ChatPrompt', question) AS answer FROM questions;
+    """
+    model = DEFAULT_MODEL
+    temperature = None
+    # Requests in flight at once, across all of DuckDB's threads
+    concurrency = 8
+    cache_path = DEFAULT_CACHE_PATH
+    # Defaults to openai.api_base, which is read from OPENAI_API_BASE
+    api_base = None
+    retries = 3
+
+    def setup(self):
+        self.cache = ResponseCache(self.cache_path) if self.cache_path else None
+
+    def teardown(self):
+        if self.cache:
+            self.cache.close()
+
+    def process_batch(self, input_phrases):
+        requests = [None if phrase is None else chat_request(self.model, phrase, 1, self.temperature)
+                    for phrase in input_phrases]
+        responses = complete_all(requests, self.concurrency, self.cache, self.api_base, self.retries)
+        return [None if choices is None else choices[0]["message"] for choices in responses]
+
+    def __call__(self, input_phrase):
+        return self.process_batch([input_phrase])[0]
+
+
+class Completion(NamedTuple):
+    prompt: str
+    index: int
+    message: str
+    message_role: str
+    finish_reason: str
+
+
+@ducktable
+def prompts(input_phrases, num_responses=1, model=DEFAULT_MODEL, temperature=None, concurrency=8,
+            cache_path=DEFAULT_CACHE_PATH, api_base=None) -> Iterator[Completion]:
+    """
+    Like prompt(), for a list of prompts sent concurrently, with responses cached on disk.
+
+    SQL Usage:
+    SELECT * FROM pytable('ducktables.openai:prompts', ['Write a haiku about SQL', 'Write a limerick about SQL'],
+      kwargs = {'num_responses': 2, 'concurrency': 4});
+    """
+    if isinstance(input_phrases, str):
+        input_phrases = [input_phrases]
+    requests = [chat_request(model, phrase, num_responses, temperature) for phrase in input_phrases]
+    cache = ResponseCache(cache_path) if cache_path else None
+    try:
+        responses = complete_all(requests, concurrency, cache, api_base)
+    finally:
+        if cache:
+            cache.close()
+    for phrase, choices in zip(input_phrases, responses):
+        for choice in choices:
+            yield Completion(phrase, choice["index"], choice["message"], choice["message_role"],
+                             choice["finish_reason"])
+
 def main(args):
     for msg in prompt("Hello there!"):
         print(msg)
@@ -1,2 +1,95 @@
+import datetime
+import os
+import threading
+import time
+from unittest import TestCase, mock, skipIf
 
-from ducktables import aws
+try:
+    import boto3
+    from ducktables import aws, Cursor
+    try:
+        from moto import mock_aws
+    except ImportError:
+        # moto < 5
+        from moto import mock_s3 as mock_aws
+except ImportError:
+    mock_aws = None
+
+
+@skipIf(mock_aws is None, "needs boto3 and moto")
+class TestS3Objects(TestCase):
+    """
+    Lists a bucket in moto's in process stand-in for S3. Set S3_ENDPOINT_URL to run against a
+    server instead, such as `moto_server` or MinIO.
+    """
+
+    KEYS = ['top', 'a/1', 'a/2', 'a/deeper/1', 'b/1', 'c/d/e'] + [f'logs/{i:04d}' for i in range(1500)]
+
+    def setUp(self):
+        os.environ.setdefault('AWS_ACCESS_KEY_ID', 'testing')
+        os.environ.setdefault('AWS_SECRET_ACCESS_KEY', 'testing')
+        os.environ.setdefault('AWS_DEFAULT_REGION', 'us-east-1')
+        self.endpoint_url = os.environ.get('S3_ENDPOINT_URL')
+        if not self.endpoint_url:
+            self.mock = mock_aws()
+            self.mock.start()
+            self.addCleanup(self.mock.stop)
+        s3 = boto3.client('s3', endpoint_url=self.endpoint_url)
+        self.bucket = f'ducktables-test-{id(self)}'
+        s3.create_bucket(Bucket=self.bucket)
+        for key in self.KEYS:
+            s3.put_object(Bucket=self.bucket, Key=key, Body=b'abc')
+
+    def list(self, *args, **kwargs):
+        rows = list(aws.s3_objects(self.bucket, *args, endpoint_url=self.endpoint_url, **kwargs))
+        cursors = [row for row in rows if isinstance(row, Cursor)]
+        return [row for row in rows if not isinstance(row, Cursor)], cursors
+
+    def test_typed_rows(self):
+        rows, _ = self.list()
+        row = next(row for row in rows if row.key == 'top')
+        self.assertIsInstance(row.last_modified, datetime.datetime)
+        self.assertEqual(3, row.size)
+        self.assertEqual(['VARCHAR', 'TIMESTAMP', 'BIGINT', 'VARCHAR'], aws.s3_objects.column_duckdb_types())
+
+    def test_concurrent_listing_finds_every_key(self):
+        for concurrency in (1, 2, 8):
+            rows, cursors = self.list(concurrency=concurrency)
+            self.assertEqual(sorted(self.KEYS), sorted(row.key for row in rows))
+            self.assertEqual(max(self.KEYS), cursors[-1].value)
+
+    def test_prefix(self):
+        rows, _ = self.list('a/')
+        self.assertEqual(['a/1', 'a/2', 'a/deeper/1'], sorted(row.key for row in rows))
+
+    def test_resumes_after_cursor(self):
+        rows, cursors = self.list(cursor='logs/1400')
+        self.assertEqual(100, len(rows))
+        self.assertTrue(all(row.key > 'logs/1400' for row in rows))
+        self.assertEqual('top', cursors[-1].value)
+
+    def test_stopping_early(self):
+        objects = aws.s3_objects(self.bucket, endpoint_url=self.endpoint_url)
+        next(objects)
+        objects.close()
+
+    def test_levels_listed_concurrently(self):
+        lock = threading.Lock()
+        listing = {'now': 0, 'peak': 0}
+        pages = aws._pages
+
+        def slow_pages(*args, **kwargs):
+            with lock:
+                listing['now'] += 1
+                listing['peak'] = max(listing['peak'], listing['now'])
+            try:
+                time.sleep(0.05)
+                yield from pages(*args, **kwargs)
+            finally:
+                with lock:
+                    listing['now'] -= 1
+
+        with mock.patch.object(aws, '_pages', slow_pages):
+            rows, _ = self.list(concurrency=8)
+        self.assertEqual(sorted(self.KEYS), sorted(row.key for row in rows))
+        self.assertGreater(listing['peak'], 1)
@@ -1,8 +1,11 @@
 
 from unittest import TestCase
-from ducktables import ducktable, DuckTableSchemaWrapper
+from ducktables import ducktable, deterministic, volatile, DuckTableSchemaWrapper, ScalarUDF, Cursor, Sink
 
-from typing import Iterator, Tuple, List, Dict
+import asyncio
+import datetime
+from dataclasses import dataclass
+from typing import AsyncIterator, Iterator, Tuple, List, Dict, NamedTuple, Optional, TypedDict
 
 # Table function that will be the basis for all of our tests. Strategy is to
 # create other functions that delegate to this function so we have consistent
@@ -94,3 +97,169 @@ class TestDuckTableSchemaWrapper(TestCase):
         actual_columns = some_types.column_types()
         expected_columns = None
         self.assertEqual(expected_columns, actual_columns)
+
+    def test_dataclass_rows(self):
+        """Dataclass rows provide both column names and types"""
+        @dataclass
+        class CharAt:
+            index: int
+            char: str
+            tags: List[str]
+            extra: Optional[Dict[str, float]] = None
+
+        @ducktable
+        def some_types(input) -> Iterator[CharAt]:
+            return (CharAt(i, c, []) for i, c in index_chars(input))
+
+        self.assertEqual(['index', 'char', 'tags', 'extra'], some_types.column_names())
+        self.assertEqual([int, str, List[str], Optional[Dict[str, float]]], some_types.column_types())
+        self.assertEqual(['BIGINT', 'VARCHAR', 'VARCHAR[]', 'MAP(VARCHAR, DOUBLE)'],
+                         some_types.column_duckdb_types())
+
+    def test_namedtuple_rows(self):
+        """NamedTuple rows provide both column names and types"""
+        class CharAt(NamedTuple):
+            index: int
+            char: str
+
+        @ducktable
+        def some_types(input) -> Iterator[CharAt]:
+            return (CharAt(i, c) for i, c in index_chars(input))
+
+        self.assertEqual(['index', 'char'], some_types.column_names())
+        self.assertEqual(['BIGINT', 'VARCHAR'], some_types.column_duckdb_types())
+        self.assertEqual([CharAt(0, 'f'), CharAt(1, 'o'), CharAt(2, 'o')], list(some_types('foo')))
+
+    def test_async_generator_rows(self):
+        """Async generators declare their rows the same way"""
+        class CharAt(NamedTuple):
+            index: int
+            char: str
+
+        @ducktable
+        async def some_types(input) -> AsyncIterator[CharAt]:
+            for i, c in index_chars(input):
+                yield CharAt(i, c)
+
+        async def collect():
+            return [row async for row in some_types('foo')]
+
+        self.assertEqual(['index', 'char'], some_types.column_names())
+        self.assertEqual(['BIGINT', 'VARCHAR'], some_types.column_duckdb_types())
+        self.assertEqual([CharAt(0, 'f'), CharAt(1, 'o'), CharAt(2, 'o')], asyncio.run(collect()))
+
+    def test_typeddict_rows(self):
+        """TypedDict rows provide both column names and types"""
+        class CharAt(TypedDict):
+            index: int
+            char: str
+
+        @ducktable
+        def some_types(input) -> List[CharAt]:
+            return [{'index': i, 'char': c} for i, c in index_chars(input)]
+
+        self.assertEqual(['index', 'char'], some_types.column_names())
+        self.assertEqual(['BIGINT', 'VARCHAR'], some_types.column_duckdb_types())
+
+    def test_nested_row_types(self):
+        """Nested row classes become structs"""
+        class Point(NamedTuple):
+            x: float
+            y: float
+
+        @dataclass
+        class Shape:
+            name: str
+            points: List[Point]
+
+        @ducktable
+        def shapes() -> Iterator[Shape]:
+            return iter([])
+
+        self.assertEqual(['VARCHAR', 'STRUCT("x" DOUBLE, "y" DOUBLE)[]'], shapes.column_duckdb_types())
+
+    def test_duckdb_types_for_simple_annotations(self):
+        """Tuple rows get DuckDB types too"""
+        @ducktable
+        def some_types(input) -> Iterator[Tuple[int, str, datetime.date, Tuple[int, ...]]]:
+            return index_chars(input)
+        self.assertEqual(['BIGINT', 'VARCHAR', 'DATE', 'BIGINT[]'], some_types.column_duckdb_types())
+
+    def test_duckdb_types_unsupported(self):
+        """Annotations without a DuckDB equivalent produce no DuckDB types"""
+        @ducktable
+        def some_types(input) -> Iterator[Tuple[int, object]]:
+            return index_chars(input)
+        self.assertEqual([int, object], some_types.column_types())
+        self.assertIsNone(some_types.column_duckdb_types())
+
+
+class TestDeterminism(TestCase):
+
+    def test_declarations(self):
+        """The decorators mark functions without wrapping them"""
+        @deterministic
+        def double(x):
+            return x * 2
+
+        @volatile
+        def now():
+            return datetime.datetime.now()
+
+        self.assertTrue(double.__ducktables_deterministic__)
+        self.assertFalse(now.__ducktables_deterministic__)
+        self.assertEqual(4, double(2))
+
+
+class TestScalarUDF(TestCase):
+
+    def test_lifecycle_defaults(self):
+        """setup() and teardown() are optional"""
+        class Upper(ScalarUDF):
+            def __call__(self, value):
+                return value.upper()
+
+        udf = Upper()
+        udf.setup()
+        self.assertEqual('FOO', udf('foo'))
+        udf.teardown()
+
+    def test_call_required(self):
+        class Nothing(ScalarUDF):
+            pass
+
+        with self.assertRaises(NotImplementedError):
+            Nothing()('foo')
+
+
+class TestSink(TestCase):
+
+    def test_lifecycle_defaults(self):
+        """Only write() has to be defined, finalize() is called on the class"""
+        class Collect(Sink):
+            def setup(self):
+                self.rows = []
+
+            def write(self, batch):
+                self.rows.extend(zip(*batch.values()))
+
+        sink = Collect()
+        sink.setup()
+        sink.write({'a': [1, 2], 'b': ['x', 'y']})
+        sink.flush()
+        Collect.finalize()
+        self.assertEqual([(1, 'x'), (2, 'y')], sink.rows)
+
+    def test_write_required(self):
+        with self.assertRaises(NotImplementedError):
+            Sink().write({})
+
+
+class TestCursor(TestCase):
+
+    def test_marker(self):
+        """The extension recognises cursors by their __ducktables_cursor__ attribute"""
+        cursor = Cursor({'after': 'key-42'})
+        self.assertEqual({'after': 'key-42'}, cursor.__ducktables_cursor__)
+        self.assertEqual({'after': 'key-42'}, cursor.value)
+        self.assertEqual("Cursor({'after': 'key-42'})", repr(cursor))
@@ -1,3 +1,142 @@
+import json
+import os
+import tempfile
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from unittest import TestCase, skipIf
 
+try:
+    import openai as openai_client
+    from ducktables import openai
+except ImportError:
+    openai = None
 
-from ducktables import openai
+
+class ChatServer(ThreadingHTTPServer):
+    """Answers chat completions by echoing the prompt, counting requests and how many overlap"""
+
+    daemon_threads = True
+
+    def __init__(self):
+        super().__init__(('127.0.0.1', 0), ChatHandler)
+        self.lock = threading.Lock()
+        self.requests = 0
+        self.in_flight = 0
+        self.max_in_flight = 0
+        self.delay = 0.05
+
+
+class ChatHandler(BaseHTTPRequestHandler):
+
+    def do_POST(self):
+        server = self.server
+        body = json.loads(self.rfile.read(int(self.headers['Content-Length'])))
+        with server.lock:
+            server.requests += 1
+            server.in_flight += 1
+            server.max_in_flight = max(server.max_in_flight, server.in_flight)
+        try:
+            time.sleep(server.delay)
+            content = f"{body['model']}: {body['messages'][0]['content']}"
+            response = json.dumps({
+                'id': 'chatcmpl-test',
+                'object': 'chat.completion',
+                'created': 0,
+                'model': body['model'],
+                'choices': [{
+                    'index': i,
+                    'message': {'role': 'assistant', 'content': content},
+                    'finish_reason': 'stop',
+                } for i in range(body.get('n', 1))],
+                'usage': {'prompt_tokens': 1, 'completion_tokens': 1, 'total_tokens': 2},
+            }).encode()
+        finally:
+            with server.lock:
+                server.in_flight -= 1
+        self.send_response(200)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(response)))
+        self.end_headers()
+        self.wfile.write(response)
+
+    def log_message(self, format, *args):
+        pass
+
+
+@skipIf(openai is None, "needs openai")
+class TestChatPrompt(TestCase):
+
+    def setUp(self):
+        self.server = ChatServer()
+        threading.Thread(target=self.server.serve_forever, daemon=True).start()
+        self.addCleanup(self.server.server_close)
+        self.addCleanup(self.server.shutdown)
+        api_key = openai_client.api_key
+        openai_client.api_key = 'test'
+        self.addCleanup(setattr, openai_client, 'api_key', api_key)
+
+        directory = tempfile.TemporaryDirectory()
+        self.addCleanup(directory.cleanup)
+        api_base = f'http://127.0.0.1:{self.server.server_port}/v1'
+
+        class TestPrompt(openai.ChatPrompt):
+            cache_path = os.path.join(directory.name, 'cache.sqlite3')
+            concurrency = 4
+        TestPrompt.api_base = api_base
+        self.udf = TestPrompt
+        self.api_base = api_base
+
+    def call(self, udf, prompts):
+        instance = udf()
+        instance.setup()
+        try:
+            return instance.process_batch(prompts)
+        finally:
+            instance.teardown()
+
+    def test_batch(self):
+        prompts = ['one', 'two', None, 'one']
+        self.assertEqual(self.call(self.udf, prompts),
+                         ['gpt-3.5-turbo: one', 'gpt-3.5-turbo: two', None, 'gpt-3.5-turbo: one'])
+        # Repeated prompts are only sent once
+        self.assertEqual(self.server.requests, 2)
+
+    def test_cache(self):
+        self.call(self.udf, ['one', 'two'])
+        self.assertEqual(self.call(self.udf, ['two', 'one']), ['gpt-3.5-turbo: two', 'gpt-3.5-turbo: one'])
+        self.assertEqual(self.server.requests, 2)
+
+        class OtherModel(self.udf):
+            model = 'gpt-4'
+        self.assertEqual(self.call(OtherModel, ['one']), ['gpt-4: one'])
+        self.assertEqual(self.server.requests, 3)
+
+        # Another endpoint for the same request isn't answered from the cache
+        other = ChatServer()
+        threading.Thread(target=other.serve_forever, daemon=True).start()
+        self.addCleanup(other.server_close)
+        self.addCleanup(other.shutdown)
+
+        class OtherEndpoint(self.udf):
+            api_base = f'http://127.0.0.1:{other.server_port}/v1'
+        self.assertEqual(self.call(OtherEndpoint, ['one']), ['gpt-3.5-turbo: one'])
+        self.assertEqual(other.requests, 1)
+
+    def test_concurrency(self):
+        prompts = [f'prompt {i}' for i in range(20)]
+        self.assertEqual(self.call(self.udf, prompts), [f'gpt-3.5-turbo: {p}' for p in prompts])
+        self.assertEqual(self.server.requests, 20)
+        self.assertGreater(self.server.max_in_flight, 1)
+        self.assertLessEqual(self.server.max_in_flight, 4)
+
+    def test_prompts(self):
+        rows = list(openai.prompts(['one', 'two'], num_responses=2, cache_path=self.udf.cache_path,
+                                   api_base=self.api_base))
+        self.assertEqual([(row.prompt, row.index, row.message) for row in rows], [
+            ('one', 0, 'gpt-3.5-turbo: one'),
+            ('one', 1, 'gpt-3.5-turbo: one'),
+            ('two', 0, 'gpt-3.5-turbo: two'),
+            ('two', 1, 'gpt-3.5-turbo: two'),
+        ])
+        self.assertEqual(rows[0].finish_reason, 'stop')
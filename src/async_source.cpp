@@ -0,0 +1,183 @@
+#include <async_source.hpp>
+#include <python_exception.hpp>
+#include <stdexcept>
+
+namespace pyudf {
+
+const duckdb::idx_t ASYNC_BUFFER_ROWS = STANDARD_VECTOR_SIZE * 2;
+const duckdb::idx_t DEFAULT_ASYNC_CONCURRENCY = 64;
+
+// Driving the async iterable is far simpler in Python than against the C API. The module is
+// compiled from this source the first time an async source is scanned.
+static const char *ASYNC_MODULE_NAME = "_pytables_async";
+static const char *ASYNC_MODULE_SOURCE = R"PY(
+import asyncio
+import collections
+import inspect
+import threading
+
+# How often a consumer waiting on rows checks in, so a cancelled query can interrupt it
+POLL_SECONDS = 0.1
+
+_loop = None
+_loop_lock = threading.Lock()
+
+def event_loop():
+    """The extension's event loop, run on its own thread and shared by every async source"""
+    global _loop
+    with _loop_lock:
+        if _loop is None:
+            loop = asyncio.new_event_loop()
+            threading.Thread(target=loop.run_forever, name="pytables-asyncio", daemon=True).start()
+            _loop = loop
+        return _loop
+
+class _Feed:
+    """Rows gathered on the event loop, handed to a consumer on another thread"""
+
+    def __init__(self, buffer_rows):
+        self.buffer_rows = buffer_rows
+        self.rows = collections.deque()
+        self.ready = threading.Condition()
+        self.finished = False
+        self.error = None
+        # Set once the producer is waiting for the consumer to make room
+        self.full = False
+        self.space = None
+
+    async def run(self, aiterable, concurrency):
+        self.space = asyncio.Event()
+        # Rows in the order they were yielded, awaitable ones as tasks running alongside each other
+        pending = collections.deque()
+        aiterator = None
+        try:
+            aiterator = aiterable.__aiter__()
+            while True:
+                try:
+                    row = await aiterator.__anext__()
+                except StopAsyncIteration:
+                    break
+                if inspect.isawaitable(row):
+                    row = asyncio.ensure_future(row)
+                pending.append(row)
+                while pending and (len(pending) >= concurrency or _resolved(pending[0])):
+                    await self.put(await _result(pending.popleft()))
+            while pending:
+                await self.put(await _result(pending.popleft()))
+        except BaseException as error:
+            for row in pending:
+                if isinstance(row, asyncio.Future):
+                    row.cancel()
+            if not isinstance(error, asyncio.CancelledError):
+                self.error = error
+            if hasattr(aiterator, "aclose"):
+                await aiterator.aclose()
+            if isinstance(error, asyncio.CancelledError):
+                raise
+        finally:
+            with self.ready:
+                self.finished = True
+                self.ready.notify()
+
+    async def put(self, row):
+        while True:
+            with self.ready:
+                if len(self.rows) < self.buffer_rows:
+                    self.rows.append(row)
+                    self.ready.notify()
+                    return
+                self.full = True
+                self.space.clear()
+            await self.space.wait()
+
+    def take(self):
+        with self.ready:
+            while not self.rows:
+                if self.finished:
+                    return self._end()
+                # Returns to Python regularly so an interrupt raised in this thread is noticed
+                self.ready.wait(POLL_SECONDS)
+            row = self.rows.popleft()
+            if self.full and len(self.rows) <= self.buffer_rows // 2:
+                self.full = False
+                _loop.call_soon_threadsafe(self.space.set)
+            return row
+
+    def _end(self):
+        if self.error is not None:
+            error, self.error = self.error, None
+            raise error
+        raise StopIteration
+
+def _resolved(row):
+    return not isinstance(row, asyncio.Future) or row.done()
+
+async def _result(row):
+    return await row if isinstance(row, asyncio.Future) else row
+
+class AsyncRows:
+    """
+    Iterates an async iterable for a table function scan. The iterable runs on the extension's
+    event loop and gathers up to 'buffer_rows' rows ahead of the scan, so it keeps awaiting while
+    DuckDB works on the previous chunk. Yielded awaitables are awaited as rows, up to
+    'concurrency' of them at once, and their results returned in the order they were yielded.
+    """
+
+    def __init__(self, aiterable, buffer_rows, concurrency):
+        self.feed = _Feed(max(1, buffer_rows))
+        # The loop only refers to the feed, so dropping this stops the source
+        self.future = asyncio.run_coroutine_threadsafe(
+            self.feed.run(aiterable, max(1, concurrency)), event_loop())
+
+    def __iter__(self):
+        return self
+
+    def __next__(self):
+        return self.feed.take()
+
+    def __del__(self):
+        self.future.cancel()
+)PY";
+
+// _pytables_async.AsyncRows, created once and kept for the life of the interpreter
+static PyObject *LoadAsyncRows() {
+	PyObject *code = Py_CompileString(ASYNC_MODULE_SOURCE, "<pytables async>", Py_file_input);
+	if (!code) {
+		PythonException error;
+		throw std::runtime_error("Failed to compile the async source driver: " + error.message);
+	}
+	PyObject *module = PyImport_ExecCodeModule(ASYNC_MODULE_NAME, code);
+	Py_DECREF(code);
+	if (!module) {
+		PythonException error;
+		throw std::runtime_error("Failed to load the async source driver: " + error.message);
+	}
+	PyObject *async_rows = PyObject_GetAttrString(module, "AsyncRows");
+	Py_DECREF(module);
+	if (!async_rows) {
+		PythonException error;
+		throw std::runtime_error(error.message);
+	}
+	return async_rows;
+}
+
+PyObject *ScanIterator(PyObject *result, duckdb::idx_t async_concurrency) {
+	if (PyIter_Check(result)) {
+		return result;
+	}
+	if (!PyObject_HasAttrString(result, "__aiter__")) {
+		Py_DECREF(result);
+		return nullptr;
+	}
+	static PyObject *async_rows = LoadAsyncRows();
+	PyObject *iterator = PyObject_CallFunction(async_rows, "OKK", result, (unsigned long long)ASYNC_BUFFER_ROWS,
+	                                           (unsigned long long)async_concurrency);
+	Py_DECREF(result);
+	if (!iterator) {
+		PythonException error;
+		throw std::runtime_error("Failed to start the async source: " + error.message);
+	}
+	return iterator;
+}
+
+} // namespace pyudf
@@ -0,0 +1,161 @@
+#include <cursor_store.hpp>
+#include <python_exception.hpp>
+#include <log.hpp>
+#include <stdexcept>
+#include <duckdb/catalog/catalog.hpp>
+#include <duckdb/catalog/catalog_entry/table_catalog_entry.hpp>
+#include <duckdb/common/constants.hpp>
+#include <duckdb/common/types/timestamp.hpp>
+#include <duckdb/main/appender.hpp>
+#include <duckdb/parser/parsed_data/create_table_info.hpp>
+#include <duckdb/storage/data_table.hpp>
+#include <duckdb/storage/table/scan_state.hpp>
+#include <duckdb/transaction/duck_transaction.hpp>
+
+namespace pyudf {
+
+const char *CURSOR_TABLE = "pytables_cursors";
+
+// The cursors table, created if 'create' is set and it doesn't exist yet. Otherwise returns null
+// when there is none, so scans that have never saved a cursor don't add the table.
+static duckdb::optional_ptr<duckdb::TableCatalogEntry> GetCursorTable(duckdb::ClientContext &context, bool create) {
+	auto table = duckdb::Catalog::GetEntry<duckdb::TableCatalogEntry>(context, INVALID_CATALOG, DEFAULT_SCHEMA,
+	                                                                  CURSOR_TABLE, true);
+	if (!table && create) {
+		auto info = duckdb::make_uniq<duckdb::CreateTableInfo>(INVALID_CATALOG, DEFAULT_SCHEMA, CURSOR_TABLE);
+		info->columns.AddColumn(duckdb::ColumnDefinition("name", duckdb::LogicalType::VARCHAR));
+		info->columns.AddColumn(duckdb::ColumnDefinition("cursor", duckdb::LogicalType::VARCHAR));
+		info->columns.AddColumn(duckdb::ColumnDefinition("updated_at", duckdb::LogicalType::TIMESTAMP));
+		info->on_conflict = duckdb::OnCreateConflict::IGNORE_ON_CONFLICT;
+		duckdb::Catalog::GetCatalog(context, INVALID_CATALOG).CreateTable(context, std::move(info));
+		table = duckdb::Catalog::GetEntry<duckdb::TableCatalogEntry>(context, INVALID_CATALOG, DEFAULT_SCHEMA,
+		                                                             CURSOR_TABLE);
+	}
+	return table;
+}
+
+// Finds the rows saved under 'name' that the context's transaction sees, including those written
+// earlier in it. There is normally one, tables written by earlier versions may hold several.
+// 'cursor' is set to the last one's.
+static void FindCursorRows(duckdb::ClientContext &context, duckdb::TableCatalogEntry &table, const std::string &name,
+                           std::vector<duckdb::row_t> &row_ids, std::string &cursor) {
+	auto &storage = table.GetStorage();
+	auto &transaction = duckdb::DuckTransaction::Get(context, table.catalog);
+
+	duckdb::TableScanState state;
+	std::vector<duckdb::column_t> column_ids {0, 1, duckdb::COLUMN_IDENTIFIER_ROW_ID};
+	storage.InitializeScan(transaction, state, column_ids);
+	duckdb::DataChunk chunk;
+	chunk.Initialize(duckdb::Allocator::Get(context),
+	                 {duckdb::LogicalType::VARCHAR, duckdb::LogicalType::VARCHAR, duckdb::LogicalType::ROW_TYPE});
+	while (true) {
+		chunk.Reset();
+		storage.Scan(transaction, chunk, state);
+		if (chunk.size() == 0) {
+			break;
+		}
+		for (duckdb::idx_t row = 0; row < chunk.size(); row++) {
+			auto row_name = chunk.GetValue(0, row);
+			if (row_name.IsNull() || row_name.ToString() != name) {
+				continue;
+			}
+			auto row_cursor = chunk.GetValue(1, row);
+			cursor = row_cursor.IsNull() ? "" : row_cursor.ToString();
+			row_ids.push_back(chunk.GetValue(2, row).GetValue<int64_t>());
+		}
+	}
+}
+
+std::string LoadCursor(duckdb::ClientContext &context, const std::string &name) {
+	auto table = GetCursorTable(context, false);
+	std::string cursor;
+	if (table) {
+		std::vector<duckdb::row_t> row_ids;
+		FindCursorRows(context, *table, name, row_ids, cursor);
+	}
+	return cursor;
+}
+
+void SaveCursor(duckdb::ClientContext &context, const std::string &name, const std::string &cursor_json) {
+	auto &table = *GetCursorTable(context, true);
+
+	// Replace the stream's row, in the same transaction as the append
+	std::vector<duckdb::row_t> row_ids;
+	std::string previous;
+	FindCursorRows(context, table, name, row_ids, previous);
+	for (duckdb::idx_t offset = 0; offset < row_ids.size(); offset += STANDARD_VECTOR_SIZE) {
+		auto count = duckdb::MinValue<duckdb::idx_t>(STANDARD_VECTOR_SIZE, row_ids.size() - offset);
+		duckdb::Vector ids(duckdb::LogicalType::ROW_TYPE, (duckdb::data_ptr_t)(row_ids.data() + offset));
+		table.GetStorage().Delete(table, context, ids, count);
+	}
+
+	duckdb::InternalAppender appender(context, table);
+	appender.BeginRow();
+	appender.Append<duckdb::string_t>(duckdb::string_t(name));
+	appender.Append<duckdb::string_t>(duckdb::string_t(cursor_json));
+	appender.Append<duckdb::timestamp_t>(duckdb::Timestamp::GetCurrentTimestamp());
+	appender.EndRow();
+	appender.Close();
+	debug("Saved cursor '" + name + "': " + cursor_json);
+}
+
+// json.loads or json.dumps, imported once and kept for the life of the interpreter
+static PyObject *JSONFunction(const char *name) {
+	PyObject *json = PyImport_ImportModule("json");
+	if (!json) {
+		PythonException error;
+		throw std::runtime_error("Failed to import json: " + error.message);
+	}
+	PyObject *function = PyObject_GetAttrString(json, name);
+	Py_DECREF(json);
+	if (!function) {
+		PythonException error;
+		throw std::runtime_error(error.message);
+	}
+	return function;
+}
+
+PyObject *CursorFromJSON(const std::string &cursor_json) {
+	if (cursor_json.empty()) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+	static PyObject *loads = JSONFunction("loads");
+	PyObject *cursor = PyObject_CallFunction(loads, "s#", cursor_json.data(), (Py_ssize_t)cursor_json.size());
+	if (!cursor) {
+		PythonException error;
+		throw std::runtime_error("Saved cursor is not valid JSON: " + error.message);
+	}
+	return cursor;
+}
+
+std::string CursorToJSON(PyObject *cursor, const std::string &name) {
+	static PyObject *dumps = JSONFunction("dumps");
+	PyObject *py_json = PyObject_CallFunctionObjArgs(dumps, cursor, nullptr);
+	if (!py_json) {
+		PythonException error;
+		throw std::runtime_error("Cursor for '" + name + "' can't be saved as JSON: " + error.message);
+	}
+	PyObject *utf8 = PyUnicode_AsUTF8String(py_json);
+	Py_DECREF(py_json);
+	if (!utf8) {
+		PythonException error;
+		throw std::runtime_error(error.message);
+	}
+	std::string result(PyBytes_AsString(utf8), PyBytes_Size(utf8));
+	Py_DECREF(utf8);
+	return result;
+}
+
+PyObject *GetCursorMarker(PyObject *row) {
+	if (PyTuple_Check(row) || PyList_Check(row) || PyDict_Check(row)) {
+		return nullptr;
+	}
+	PyObject *cursor = PyObject_GetAttrString(row, "__ducktables_cursor__");
+	if (!cursor) {
+		PyErr_Clear();
+	}
+	return cursor;
+}
+
+} // namespace pyudf
@@ -0,0 +1,205 @@
+#include <function_registry.hpp>
+#include <interpreter.hpp>
+#include <pyconvert.hpp>
+#include <python_exception.hpp>
+#include <log.hpp>
+#include <function_stats.hpp>
+#include <duckdb/common/vector_operations/unary_executor.hpp>
+#include <sys/stat.h>
+#include <stdexcept>
+
+using namespace duckdb;
+namespace pyudf {
+
+static const int64_t NO_MTIME = -1;
+
+// How often a module's source file is checked for changes, so that functions looked up for
+// every chunk or query don't stat() it each time
+static const uint64_t MTIME_CHECK_INTERVAL_NS = 1000000000;
+
+static int64_t FileMTime(const std::string &path) {
+	struct stat st;
+	if (path.empty() || stat(path.c_str(), &st) != 0) {
+		return NO_MTIME;
+	}
+#ifdef __APPLE__
+	return int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+	return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+static std::string ModuleFile(PyObject *module) {
+	PyObject *py_file = PyObject_GetAttrString(module, "__file__");
+	std::string path;
+	if (py_file && PyUnicode_Check(py_file)) {
+		path = Unicode_AsUTF8(py_file);
+	}
+	Py_XDECREF(py_file);
+	PyErr_Clear();
+	return path;
+}
+
+FunctionRegistry &FunctionRegistry::Get() {
+	// Intentionally leaked, destroying the cached functions at exit would call into Python
+	// without holding the GIL, possibly after the interpreter is gone
+	static FunctionRegistry *registry = new FunctionRegistry();
+	return *registry;
+}
+
+void FunctionRegistry::TrackModule(const std::string &module_name) {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (modules.count(module_name)) {
+			return;
+		}
+	}
+	PyObject *module = PyImport_ImportModule(module_name.c_str());
+	if (!module) {
+		PyErr_Clear();
+		return;
+	}
+	ModuleState state;
+	state.path = ModuleFile(module);
+	state.mtime = FileMTime(state.path);
+	state.checked_ns = NowNanos();
+	Py_DECREF(module);
+
+	std::lock_guard<std::mutex> guard(lock);
+	modules[module_name] = state;
+}
+
+void FunctionRegistry::CheckForChanges(const std::string &module_name) {
+	ModuleState state;
+	auto now = NowNanos();
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto entry = modules.find(module_name);
+		if (entry == modules.end() || now - entry->second.checked_ns < MTIME_CHECK_INTERVAL_NS) {
+			return;
+		}
+		entry->second.checked_ns = now;
+		state = entry->second;
+	}
+	if (state.path.empty() || FileMTime(state.path) == state.mtime) {
+		return;
+	}
+	debug("Source of module " + module_name + " changed, reloading");
+	Reload(module_name);
+}
+
+int64_t FunctionRegistry::Invalidate(const std::string &module_name) {
+	std::lock_guard<std::mutex> guard(lock);
+	auto prefix = module_name + ":";
+	int64_t dropped = 0;
+	for (auto it = functions.begin(); it != functions.end();) {
+		if (it->first.compare(0, prefix.size(), prefix) == 0) {
+			it = functions.erase(it);
+			dropped++;
+		} else {
+			it++;
+		}
+	}
+	for (auto it = table_functions.begin(); it != table_functions.end();) {
+		if (it->first.compare(0, prefix.size(), prefix) == 0) {
+			it = table_functions.erase(it);
+			dropped++;
+		} else {
+			it++;
+		}
+	}
+	modules.erase(module_name);
+	return dropped;
+}
+
+int64_t FunctionRegistry::Reload(const std::string &module_name) {
+	auto dropped = Invalidate(module_name);
+
+	PyObject *module = PyImport_ImportModule(module_name.c_str());
+	if (!module) {
+		PythonException error;
+		throw std::runtime_error("Failed to import module: " + module_name + ": " + error.message);
+	}
+	PyObject *reloaded = PyImport_ReloadModule(module);
+	Py_DECREF(module);
+	if (!reloaded) {
+		PythonException error;
+		throw std::runtime_error("Failed to reload module: " + module_name + ": " + error.message);
+	}
+	Py_DECREF(reloaded);
+	TrackModule(module_name);
+	return dropped;
+}
+
+void FunctionRegistry::Preload(const std::string &module_name) {
+	CheckForChanges(module_name);
+	PyObject *module = PyImport_ImportModule(module_name.c_str());
+	if (!module) {
+		PythonException error;
+		throw std::runtime_error("Failed to import module: " + module_name + ": " + error.message);
+	}
+	Py_DECREF(module);
+	TrackModule(module_name);
+}
+
+std::shared_ptr<PythonFunction> FunctionRegistry::GetFunction(const std::string &module_name,
+                                                              const std::string &function_name) {
+	CheckForChanges(module_name);
+	auto key = module_name + ":" + function_name;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto entry = functions.find(key);
+		if (entry != functions.end()) {
+			return entry->second;
+		}
+	}
+	auto function = std::make_shared<PythonFunction>(module_name, function_name);
+	TrackModule(module_name);
+
+	std::lock_guard<std::mutex> guard(lock);
+	functions[key] = function;
+	return function;
+}
+
+std::shared_ptr<PythonFunction> FunctionRegistry::GetFunction(const std::string &function_specifier) {
+	std::string module_name;
+	std::string function_name;
+	std::tie(module_name, function_name) = parse_func_specifier(function_specifier);
+	return GetFunction(module_name, function_name);
+}
+
+std::shared_ptr<PythonTableFunction> FunctionRegistry::GetTableFunction(const std::string &module_name,
+                                                                        const std::string &function_name) {
+	CheckForChanges(module_name);
+	auto key = module_name + ":" + function_name;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto entry = table_functions.find(key);
+		if (entry != table_functions.end()) {
+			return entry->second;
+		}
+	}
+	auto function = std::make_shared<PythonTableFunction>(module_name, function_name);
+	TrackModule(module_name);
+
+	std::lock_guard<std::mutex> guard(lock);
+	table_functions[key] = function;
+	return function;
+}
+
+static void PyReloadFunction(DataChunk &args, ExpressionState &state, Vector &result) {
+	GILGuard gil;
+	UnaryExecutor::Execute<string_t, int64_t>(args.data[0], result, args.size(), [&](string_t module_name) {
+		return FunctionRegistry::Get().Reload(module_name.GetString());
+	});
+}
+
+CreateScalarFunctionInfo GetReloadFunction() {
+	auto reload_func =
+	    ScalarFunction("pytables_reload", {LogicalType::VARCHAR}, LogicalType::BIGINT, PyReloadFunction);
+	// Never constant fold this away
+	reload_func.side_effects = FunctionSideEffects::HAS_SIDE_EFFECTS;
+	return CreateScalarFunctionInfo(reload_func);
+}
+
+} // namespace pyudf
@@ -0,0 +1,93 @@
+#include <function_stats.hpp>
+#include <sstream>
+
+using namespace duckdb;
+namespace pyudf {
+
+static std::string FormatMillis(uint64_t nanos) {
+	std::ostringstream out;
+	out.precision(3);
+	out << std::fixed << (double)nanos / 1000000.0 << "ms";
+	return out.str();
+}
+
+std::string FunctionStats::ToString() const {
+	std::string result;
+	result += "calls: " + std::to_string(calls.load()) + "\n";
+	result += "rows: " + std::to_string(rows.load()) + "\n";
+	result += "python: " + FormatMillis(python_ns.load()) + "\n";
+	result += "conversion: " + FormatMillis(conversion_ns.load()) + "\n";
+	result += "gil wait: " + FormatMillis(gil_wait_ns.load()) + "\n";
+	result += "null conversions: " + std::to_string(null_conversions.load()) + "\n";
+	result += "exceptions: " + std::to_string(exceptions.load());
+	return result;
+}
+
+StatsRegistry &StatsRegistry::Get() {
+	static StatsRegistry registry;
+	return registry;
+}
+
+std::shared_ptr<FunctionStats> StatsRegistry::For(const std::string &function_specifier) {
+	std::lock_guard<std::mutex> guard(lock);
+	auto &entry = stats[function_specifier];
+	if (!entry) {
+		entry = std::make_shared<FunctionStats>();
+	}
+	return entry;
+}
+
+std::vector<std::pair<std::string, std::shared_ptr<FunctionStats>>> StatsRegistry::All() {
+	std::lock_guard<std::mutex> guard(lock);
+	return std::vector<std::pair<std::string, std::shared_ptr<FunctionStats>>>(stats.begin(), stats.end());
+}
+
+struct PyStatsState : public GlobalTableFunctionState {
+	std::vector<std::pair<std::string, std::shared_ptr<FunctionStats>>> entries;
+	idx_t offset = 0;
+};
+
+static unique_ptr<FunctionData> PyStatsBind(ClientContext &context, TableFunctionBindInput &input,
+                                            std::vector<LogicalType> &return_types, std::vector<std::string> &names) {
+	names.emplace_back("function");
+	return_types.emplace_back(LogicalType::VARCHAR);
+	for (auto name : {"calls", "rows", "chunks", "python_ns", "conversion_ns", "gil_wait_ns", "null_conversions",
+	                  "exceptions"}) {
+		names.emplace_back(name);
+		return_types.emplace_back(LogicalType::UBIGINT);
+	}
+	return nullptr;
+}
+
+static unique_ptr<GlobalTableFunctionState> PyStatsInit(ClientContext &context, TableFunctionInitInput &input) {
+	auto result = make_uniq<PyStatsState>();
+	result->entries = StatsRegistry::Get().All();
+	return std::move(result);
+}
+
+static void PyStatsScan(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &state = (PyStatsState &)*data.global_state;
+	idx_t count = 0;
+	while (state.offset < state.entries.size() && count < STANDARD_VECTOR_SIZE) {
+		auto &entry = state.entries[state.offset++];
+		auto &stats = *entry.second;
+		output.SetValue(0, count, Value(entry.first));
+		output.SetValue(1, count, Value::UBIGINT(stats.calls.load()));
+		output.SetValue(2, count, Value::UBIGINT(stats.rows.load()));
+		output.SetValue(3, count, Value::UBIGINT(stats.chunks.load()));
+		output.SetValue(4, count, Value::UBIGINT(stats.python_ns.load()));
+		output.SetValue(5, count, Value::UBIGINT(stats.conversion_ns.load()));
+		output.SetValue(6, count, Value::UBIGINT(stats.gil_wait_ns.load()));
+		output.SetValue(7, count, Value::UBIGINT(stats.null_conversions.load()));
+		output.SetValue(8, count, Value::UBIGINT(stats.exceptions.load()));
+		count++;
+	}
+	output.SetCardinality(count);
+}
+
+unique_ptr<CreateTableFunctionInfo> GetStatsFunction() {
+	TableFunction stats_function("pytables_stats", {}, PyStatsScan, PyStatsBind, PyStatsInit);
+	return make_uniq<CreateTableFunctionInfo>(stats_function);
+}
+
+} // namespace pyudf
@@ -0,0 +1,29 @@
+#ifndef ASYNC_SOURCE_HPP
+#define ASYNC_SOURCE_HPP
+
+#include <Python.h>
+#include <duckdb.hpp>
+
+namespace pyudf {
+
+// Table functions may return an async iterable, such as an async generator, instead of an
+// iterator. It runs on an event loop owned by the extension, on its own thread, which gathers
+// rows into a buffer ahead of the scan. The scan takes rows from the buffer through an ordinary
+// iterator, so the source keeps awaiting while DuckDB works on earlier chunks without the GIL.
+//
+// Rows that are awaitable (eg coroutines) are awaited alongside each other, up to the
+// 'async_concurrency' argument at once, and produce their results in the order yielded. This is
+// how one async source gets many requests in flight.
+
+// Rows gathered ahead of the scan, enough for the next two chunks
+extern const duckdb::idx_t ASYNC_BUFFER_ROWS;
+// Default number of awaitable rows awaited at once
+extern const duckdb::idx_t DEFAULT_ASYNC_CONCURRENCY;
+
+// Takes ownership of 'result', a table function's return value, and returns the iterator to scan
+// it with: 'result' itself if it's an iterator, or an iterator fed by the event loop if it's an
+// async iterable. Returns null if it's neither. Must hold the GIL.
+PyObject *ScanIterator(PyObject *result, duckdb::idx_t async_concurrency);
+
+} // namespace pyudf
+#endif // ASYNC_SOURCE_HPP
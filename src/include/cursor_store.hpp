@@ -0,0 +1,34 @@
+#ifndef CURSOR_STORE_HPP
+#define CURSOR_STORE_HPP
+
+#include <Python.h>
+#include <string>
+#include <duckdb.hpp>
+
+namespace pyudf {
+
+// Incremental pytable scans (the 'cursor' argument) resume from the position the function
+// reported at the end of its previous run. Positions are saved as JSON in the pytables_cursors
+// table of the default database, and written in the query's own transaction, so the cursor only
+// advances if the rows it covers are committed too.
+//
+// The table holds a row of (name, cursor, updated_at) per stream, created by the first save.
+extern const char *CURSOR_TABLE;
+
+// The JSON of the cursor saved under 'name', or an empty string if there is none
+std::string LoadCursor(duckdb::ClientContext &context, const std::string &name);
+
+// Replaces the cursor for 'name' in the context's current transaction
+void SaveCursor(duckdb::ClientContext &context, const std::string &name, const std::string &cursor_json);
+
+// Converts between cursors and their JSON. Must hold the GIL. CursorFromJSON returns a new
+// reference, None for an empty string.
+PyObject *CursorFromJSON(const std::string &cursor_json);
+std::string CursorToJSON(PyObject *cursor, const std::string &name);
+
+// If 'row' is a cursor marker (an object with a __ducktables_cursor__ attribute, see
+// ducktables.Cursor) returns a new reference to the cursor it carries, otherwise null
+PyObject *GetCursorMarker(PyObject *row);
+
+} // namespace pyudf
+#endif // CURSOR_STORE_HPP
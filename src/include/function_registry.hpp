@@ -0,0 +1,64 @@
+#ifndef FUNCTION_REGISTRY_HPP
+#define FUNCTION_REGISTRY_HPP
+
+#include <Python.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <duckdb.hpp>
+#include <duckdb/parser/parsed_data/create_scalar_function_info.hpp>
+#include "python_function.hpp"
+#include "python_table_function.hpp"
+
+namespace pyudf {
+
+// Process wide cache of resolved Python callables keyed by 'module:function', so repeated
+// queries don't re-import modules, re-wrap functions, or re-derive schemas. Entries for a
+// module are dropped (and the module re-imported) when its source file's mtime changes, which
+// is checked at most once a second, or when pytables_reload('module') is called.
+//
+// All methods must be called while holding the GIL. The internal mutex only guards the maps,
+// and is never held while calling into Python.
+class FunctionRegistry {
+public:
+	static FunctionRegistry &Get();
+
+	std::shared_ptr<PythonFunction> GetFunction(const std::string &module_name, const std::string &function_name);
+	std::shared_ptr<PythonFunction> GetFunction(const std::string &function_specifier);
+	std::shared_ptr<PythonTableFunction> GetTableFunction(const std::string &module_name,
+	                                                      const std::string &function_name);
+
+	// Imports the module ahead of its first use, throwing if the import fails
+	void Preload(const std::string &module_name);
+
+	// Re-imports the module and drops every cached function belonging to it. Returns the number
+	// of functions dropped.
+	int64_t Reload(const std::string &module_name);
+
+private:
+	struct ModuleState {
+		// Empty for modules without a source file (builtins, namespace packages)
+		std::string path;
+		int64_t mtime;
+		// When the mtime was last compared, see MTIME_CHECK_INTERVAL_NS
+		uint64_t checked_ns;
+	};
+
+	// Reloads the module if its source changed since we last looked
+	void CheckForChanges(const std::string &module_name);
+	void TrackModule(const std::string &module_name);
+	int64_t Invalidate(const std::string &module_name);
+
+	std::mutex lock;
+	std::unordered_map<std::string, ModuleState> modules;
+	std::unordered_map<std::string, std::shared_ptr<PythonFunction>> functions;
+	std::unordered_map<std::string, std::shared_ptr<PythonTableFunction>> table_functions;
+};
+
+// pytables_reload('module'), for picking up changes without waiting for an mtime check
+duckdb::CreateScalarFunctionInfo GetReloadFunction();
+
+} // namespace pyudf
+#endif // FUNCTION_REGISTRY_HPP
@@ -0,0 +1,86 @@
+#ifndef FUNCTION_STATS_HPP
+#define FUNCTION_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <duckdb.hpp>
+#include <duckdb/parser/parsed_data/create_table_function_info.hpp>
+
+namespace pyudf {
+
+// Running totals for a single Python function. Callers accumulate locally and add once per
+// chunk, so the atomics are touched a handful of times per vector rather than per row.
+struct FunctionStats {
+	// Invocations of the function: once per row for pycall, once per query for pytable, once per
+	// batch for COPY ... (FORMAT python)
+	std::atomic<uint64_t> calls {0};
+	// Rows produced (pytable), processed (pycall), or written (COPY)
+	std::atomic<uint64_t> rows {0};
+	std::atomic<uint64_t> chunks {0};
+	// Time spent running Python code, including resuming a table function's iterator
+	std::atomic<uint64_t> python_ns {0};
+	// Time spent converting values between DuckDB and Python
+	std::atomic<uint64_t> conversion_ns {0};
+	// Time spent waiting to acquire the GIL
+	std::atomic<uint64_t> gil_wait_ns {0};
+	// Values which could not be converted to their column's type and became NULL
+	std::atomic<uint64_t> null_conversions {0};
+	// Python exceptions raised by the function
+	std::atomic<uint64_t> exceptions {0};
+
+	// Human readable summary, shown on the operator in EXPLAIN ANALYZE
+	std::string ToString() const;
+};
+
+// Process wide stats for each 'module:function', reported by pytables_stats()
+class StatsRegistry {
+public:
+	static StatsRegistry &Get();
+
+	// The stats for a function, created on first use. The pointer stays valid for the life of
+	// the process, so callers may hold on to it.
+	std::shared_ptr<FunctionStats> For(const std::string &function_specifier);
+	std::vector<std::pair<std::string, std::shared_ptr<FunctionStats>>> All();
+
+private:
+	std::mutex lock;
+	std::map<std::string, std::shared_ptr<FunctionStats>> stats;
+};
+
+// Monotonic clock reading in nanoseconds
+inline uint64_t NowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+	    .count();
+}
+
+inline void AddStat(std::atomic<uint64_t> &counter, uint64_t value) {
+	counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+// Counters for a single pytable call, shown on its operator by EXPLAIN, which are also added to
+// the function's process wide totals
+struct ScanStats {
+	explicit ScanStats(std::shared_ptr<FunctionStats> totals_p) : totals(std::move(totals_p)) {
+	}
+
+	FunctionStats scan;
+	std::shared_ptr<FunctionStats> totals;
+
+	void Add(std::atomic<uint64_t> FunctionStats::*counter, uint64_t value) {
+		AddStat(scan.*counter, value);
+		AddStat((*totals).*counter, value);
+	}
+};
+
+// pytables_stats(), one row per Python function used since the extension was loaded
+duckdb::unique_ptr<duckdb::CreateTableFunctionInfo> GetStatsFunction();
+
+} // namespace pyudf
+#endif // FUNCTION_STATS_HPP
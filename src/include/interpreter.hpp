@@ -0,0 +1,41 @@
+#ifndef INTERPRETER_HPP
+#define INTERPRETER_HPP
+
+#include <Python.h>
+#include <string>
+#include <vector>
+
+namespace pyudf {
+
+// Starts the Python interpreter on first use, rather than when the extension is loaded, so
+// sessions that never call Python don't pay for it. Once started the GIL is released, and any
+// thread wishing to call into Python must hold a GILGuard. Safe to call from any thread.
+void EnsureInterpreter();
+
+// Starts the interpreter if need be and holds the GIL for the lifetime of the guard. Guards may
+// be nested.
+class GILGuard {
+public:
+	GILGuard() {
+		EnsureInterpreter();
+		state = PyGILState_Ensure();
+	}
+	~GILGuard() {
+		PyGILState_Release(state);
+	}
+	GILGuard(const GILGuard &) = delete;
+	GILGuard &operator=(const GILGuard &) = delete;
+
+private:
+	PyGILState_STATE state;
+};
+
+// Splits a comma separated list of module names, ignoring whitespace and empty entries
+std::vector<std::string> ParseModuleList(const std::string &module_list);
+
+// Imports each module on a background thread so the first query using it doesn't stall on the
+// import. Failures are only logged, the query that later uses the module will report them.
+void PreloadModules(const std::vector<std::string> &module_names);
+
+} // namespace pyudf
+#endif // INTERPRETER_HPP
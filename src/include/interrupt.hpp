@@ -0,0 +1,49 @@
+#ifndef INTERRUPT_HPP
+#define INTERRUPT_HPP
+
+#include <Python.h>
+#include <cstdint>
+#include <string>
+#include <duckdb.hpp>
+
+namespace pyudf {
+
+struct WatchedThread;
+
+// Lets Python code running on behalf of a query be stopped when the query is cancelled or a call
+// runs past its timeout. A watchdog thread notices either, and raises KeyboardInterrupt in the
+// thread running the Python code via PyThreadState_SetAsyncExc(). KeyboardInterrupt isn't caught
+// by 'except Exception', so user code rarely swallows it.
+//
+// Python only checks for asynchronous exceptions between bytecodes. A call blocked inside C code
+// (eg a socket read without a timeout) is interrupted once it returns to Python.
+//
+// A watch covers a stretch of work, such as a chunk, with each call into Python bracketed by
+// BeginCall() and EndCall() so only time spent in Python counts towards the timeout. Create,
+// use, and destroy it while holding the GIL.
+class PythonCallWatch {
+public:
+	// A timeout of 0 means calls may run indefinitely, though they can still be cancelled
+	PythonCallWatch(duckdb::ClientContext &context, uint64_t timeout_ms);
+	~PythonCallWatch();
+	PythonCallWatch(const PythonCallWatch &) = delete;
+	PythonCallWatch &operator=(const PythonCallWatch &) = delete;
+
+	void BeginCall();
+	void EndCall();
+
+	// Call when a Python call fails. If the failure is our doing, clears the Python error and
+	// throws an InterruptException for cancelled queries, or an error naming 'function' for
+	// timeouts.
+	void ThrowIfInterrupted(const std::string &function);
+
+private:
+	WatchedThread &thread;
+	uint64_t timeout_ns;
+};
+
+// The pytables_timeout_ms setting, 0 if unset
+uint64_t PythonTimeoutMillis(duckdb::ClientContext &context);
+
+} // namespace pyudf
+#endif // INTERRUPT_HPP
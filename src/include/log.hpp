@@ -9,6 +9,8 @@ namespace pyudf {
 // Initialize at the start of the program
 extern bool _debugEnabled;
 
+// Traces what the extension is doing to stderr when PYTABLES_DEBUG is set. For finding where
+// time goes, see pytables_stats() instead.
 void debug(const std::string &msg);
 } // namespace pyudf
 #endif
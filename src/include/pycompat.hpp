@@ -0,0 +1,153 @@
+#ifndef PYCOMPAT_HPP
+#define PYCOMPAT_HPP
+
+#include <Python.h>
+#include <vector>
+
+// The portable build of the extension is compiled against Python's limited API so a single
+// binary works across interpreter versions. Building with -DPYTABLES_LIMITED_API=OFF produces
+// a version specific binary instead. These helpers pick CPython's faster non-stable APIs
+// (direct buffer access, unchecked macros, vectorcall) in the latter case, and fall back to
+// their limited API equivalents otherwise.
+namespace pyudf {
+
+// A view of the UTF-8 contents of a Python str. With the limited API we have to encode to an
+// intermediate bytes object, which this keeps alive for the lifetime of the view. Otherwise the
+// view points directly at the str's cached UTF-8 buffer and nothing is copied.
+class UTF8View {
+public:
+	explicit UTF8View(PyObject *unicode) : data(nullptr), size(0), bytes(nullptr) {
+#ifdef Py_LIMITED_API
+		bytes = PyUnicode_AsUTF8String(unicode);
+		if (bytes && PyBytes_AsStringAndSize(bytes, const_cast<char **>(&data), &size) < 0) {
+			data = nullptr;
+		}
+#else
+		data = PyUnicode_AsUTF8AndSize(unicode, &size);
+#endif
+		if (!data) {
+			PyErr_Clear();
+		}
+	}
+	~UTF8View() {
+		Py_XDECREF(bytes);
+	}
+	UTF8View(const UTF8View &) = delete;
+	UTF8View &operator=(const UTF8View &) = delete;
+
+	bool IsValid() const {
+		return data != nullptr;
+	}
+
+	const char *data;
+	Py_ssize_t size;
+
+private:
+	PyObject *bytes;
+};
+
+// Item access for the list or tuple returned by PySequence_Fast(). Returns a borrowed reference.
+inline PyObject *FastSequenceItem(PyObject *fast_seq, Py_ssize_t index) {
+#ifdef Py_LIMITED_API
+	return PyList_Check(fast_seq) ? PyList_GetItem(fast_seq, index) : PyTuple_GetItem(fast_seq, index);
+#else
+	return PySequence_Fast_GET_ITEM(fast_seq, index);
+#endif
+}
+
+inline Py_ssize_t FastSequenceSize(PyObject *fast_seq) {
+#ifdef Py_LIMITED_API
+	return PySequence_Size(fast_seq);
+#else
+	return PySequence_Fast_GET_SIZE(fast_seq);
+#endif
+}
+
+// Borrowed reference to an item of a tuple we know to be in range
+inline PyObject *TupleItem(PyObject *tuple, Py_ssize_t index) {
+#ifdef Py_LIMITED_API
+	return PyTuple_GetItem(tuple, index);
+#else
+	return PyTuple_GET_ITEM(tuple, index);
+#endif
+}
+
+// Calls 'callable' with positional arguments held in a C array. Uses vectorcall when available,
+// which avoids allocating an argument tuple for every invocation.
+inline PyObject *CallWithArgs(PyObject *callable, PyObject *const *args, size_t nargs) {
+#if !defined(Py_LIMITED_API) && PY_VERSION_HEX >= 0x03090000
+	return PyObject_Vectorcall(callable, args, nargs, nullptr);
+#elif !defined(Py_LIMITED_API) && PY_VERSION_HEX >= 0x03080000
+	return _PyObject_Vectorcall(callable, args, nargs, nullptr);
+#else
+	PyObject *tuple = PyTuple_New(nargs);
+	if (!tuple) {
+		return nullptr;
+	}
+	for (size_t i = 0; i < nargs; i++) {
+		Py_INCREF(args[i]);
+		PyTuple_SetItem(tuple, i, args[i]);
+	}
+	PyObject *result = PyObject_CallObject(callable, tuple);
+	Py_DECREF(tuple);
+	return result;
+#endif
+}
+
+// Positional arguments for calling a function over and over, such as once per row. With vectorcall
+// they are passed straight from the array. Otherwise they have to go in a tuple, which is reused
+// for the next call unless the function held on to it.
+class CallArguments {
+public:
+	explicit CallArguments(size_t nargs) : args(nargs, nullptr), tuple(nullptr) {
+	}
+	~CallArguments() {
+		Clear();
+		Py_XDECREF(tuple);
+	}
+	CallArguments(const CallArguments &) = delete;
+	CallArguments &operator=(const CallArguments &) = delete;
+
+	// Takes the reference to 'arg'
+	void Set(size_t index, PyObject *arg) {
+		Py_XDECREF(args[index]);
+		args[index] = arg;
+	}
+	// Drops the arguments once the call is done
+	void Clear() {
+		for (auto &arg : args) {
+			Py_XDECREF(arg);
+			arg = nullptr;
+		}
+	}
+	PyObject *Call(PyObject *callable) {
+#if !defined(Py_LIMITED_API) && PY_VERSION_HEX >= 0x03080000
+		return CallWithArgs(callable, args.data(), args.size());
+#else
+		// PyTuple_SetItem() only works on a tuple nothing else refers to
+		if (tuple && Py_REFCNT(tuple) != 1) {
+			Py_DECREF(tuple);
+			tuple = nullptr;
+		}
+		if (!tuple) {
+			tuple = PyTuple_New(args.size());
+			if (!tuple) {
+				return nullptr;
+			}
+		}
+		for (size_t i = 0; i < args.size(); i++) {
+			// Replaces, and releases, the previous call's argument
+			Py_INCREF(args[i]);
+			PyTuple_SetItem(tuple, i, args[i]);
+		}
+		return PyObject_CallObject(callable, tuple);
+#endif
+	}
+
+private:
+	std::vector<PyObject *> args;
+	PyObject *tuple;
+};
+
+} // namespace pyudf
+#endif // PYCOMPAT_HPP
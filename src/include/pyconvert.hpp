@@ -1,19 +1,153 @@
 
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <duckdb.hpp>
+#include <duckdb/common/string_map_set.hpp>
 #include <Python.h>
 
 namespace pyudf {
+// Python classes we need for converting temporal, decimal, and uuid values. These are looked
+// up once on first use and held for the life of the interpreter.
+struct PyTypeCache {
+	PyObject *date;
+	PyObject *datetime;
+	PyObject *time;
+	PyObject *timedelta;
+	PyObject *timezone_utc;
+	PyObject *decimal;
+	// A decimal context wide enough to hold DuckDB's widest DECIMAL without rounding
+	PyObject *decimal_context;
+	PyObject *uuid;
+};
+PyTypeCache &PyTypes();
+
+// isinstance() that treats errors as a negative result
+bool IsInstance(PyObject *py_item, PyObject *py_class);
+
 PyObject *duckdb_to_py(duckdb::Value &value);
 PyObject *duckdbs_to_pys(std::vector<duckdb::Value> &values);
 PyObject *StructToDict(duckdb::Value value);
 duckdb::Value ConvertPyObjectToDuckDBValue(PyObject *py_item, duckdb::LogicalType logical_type);
 void ConvertPyObjectsToDuckDBValues(PyObject *py_iterator, std::vector<duckdb::LogicalType> logical_types,
                                     std::vector<duckdb::Value> &result);
+
+// Writes a Python object directly into row 'row' of 'result'. Nested types (LIST, STRUCT, MAP)
+// are written into the vector's children. Returns false and marks the row NULL if the object
+// can not be converted to 'logical_type'.
+bool ConvertPyObjectToVector(PyObject *py_item, const duckdb::LogicalType &logical_type, duckdb::Vector &result,
+                             duckdb::idx_t row);
+
+// Writes each value of a row (a tuple, list, or other iterable) to row 'row' of the output chunk.
+// Returns the number of values that could not be converted and were written as NULL.
+duckdb::idx_t ConvertPyRowToChunk(PyObject *py_row, const std::vector<duckdb::LogicalType> &logical_types,
+                                  duckdb::DataChunk &output, duckdb::idx_t row);
+
+struct StringColumn;
+
+// Converts the rows produced by a table function. Tuples and lists (including NamedTuples) are
+// matched to columns by position, dicts (including TypedDicts) by key, and other objects such as
+// dataclasses by attribute name. Column names are interned once up front so lookups are cheap.
+//
+// Strings repeated within a chunk of a VARCHAR column, whether the same object or an equal one,
+// are only encoded and copied into the chunk once. Columns with few distinct values are handed to
+// DuckDB as dictionary vectors by FinishChunk().
+//
+// Values that can't be converted are written as NULL, except in the VARCHAR columns flagged in
+// 'stringified', which hold the str() of any value. Schema detection flags the columns it fell
+// back to VARCHAR for.
+//
+// Must be created and destroyed while holding the GIL.
+class RowConverter {
+public:
+	RowConverter(std::vector<duckdb::LogicalType> types, const std::vector<std::string> &column_names,
+	             const std::vector<bool> &stringified = {});
+	~RowConverter();
+	RowConverter(const RowConverter &) = delete;
+	RowConverter &operator=(const RowConverter &) = delete;
+
+	// Returns the number of values that could not be converted and were written as NULL
+	duckdb::idx_t Convert(PyObject *py_row, duckdb::DataChunk &output, duckdb::idx_t row);
+	// Call once the chunk's cardinality is set, before handing it to DuckDB
+	void FinishChunk(duckdb::DataChunk &output);
+
+private:
+	void ResolveRowType(PyObject *py_row);
+	bool ConvertValue(size_t col, PyObject *py_item, duckdb::DataChunk &output, duckdb::idx_t row);
+	duckdb::idx_t ConvertSequence(PyObject *py_row, duckdb::DataChunk &output, duckdb::idx_t row);
+	duckdb::idx_t ConvertAttributes(PyObject *py_row, duckdb::DataChunk &output, duckdb::idx_t row);
+
+	std::vector<duckdb::LogicalType> types;
+	// Strings written so far this chunk, for each VARCHAR column (null for other columns)
+	std::vector<std::unique_ptr<StringColumn>> string_columns;
+	std::vector<PyObject *> names;
+	// The class of the last row that was neither a tuple, list, nor dict, and whether it was iterable
+	PyObject *row_type = nullptr;
+	bool row_type_iterable = false;
+	// Offset of each column's slot within instances of row_type, or -1 to use getattr
+	std::vector<Py_ssize_t> slot_offsets;
+};
+
+// Converts the values of a vector to Python objects, reading them straight from the vector's data
+// rather than through duckdb::Value. Set the vector once per chunk, then convert its rows.
+//
+// Objects for repeated values are reused rather than built again: an entry of a constant or
+// dictionary vector is converted once, strings and values whose conversion calls a Python
+// constructor (dates, decimals, ...) are looked up among those already converted this chunk, short
+// strings are kept across chunks, and small ints come from a shared table. Only immutable objects
+// are shared, lists and dicts are always built afresh.
+//
+// Must be created, used, and destroyed while holding the GIL.
+class VectorConverter {
+public:
+	explicit VectorConverter(const duckdb::LogicalType &type);
+	~VectorConverter();
+	VectorConverter(const VectorConverter &) = delete;
+	VectorConverter &operator=(const VectorConverter &) = delete;
+
+	// 'vector' must outlive the calls to Convert() for this chunk
+	void SetVector(duckdb::Vector &vector, duckdb::idx_t count);
+	// A new reference to the value of 'row'
+	PyObject *Convert(duckdb::idx_t row);
+
+private:
+	PyObject *ConvertEntry(duckdb::idx_t row, duckdb::idx_t index);
+	PyObject *ConvertString(const duckdb::string_t &value);
+	PyObject *ConvertRaw(duckdb::idx_t row, duckdb::idx_t index);
+	PyObject *ConvertStruct(duckdb::idx_t row, duckdb::idx_t index);
+	void ClearChunk();
+
+	duckdb::LogicalType type;
+	duckdb::Vector *vector = nullptr;
+	duckdb::UnifiedVectorFormat format;
+	// Lists and structs are assembled from converters for their children
+	std::vector<std::unique_ptr<VectorConverter>> children;
+	std::vector<PyObject *> child_names;
+	// Structs of a dictionary vector are converted through duckdb::Value
+	bool struct_as_value = false;
+
+	// Converted entries of a constant or dictionary vector, by their index in its data
+	bool cache_entries = false;
+	std::unordered_map<duckdb::idx_t, PyObject *> entry_cache;
+	// Strings short enough to be stored inside their string_t (so the key owns its data), kept
+	// across chunks
+	duckdb::string_map_t<PyObject *> short_strings;
+	// Longer strings converted this chunk, keyed by the vector's own data
+	duckdb::string_map_t<PyObject *> chunk_strings;
+	// Values of up to 8 bytes that need a Python constructor, keyed by their bits, this chunk
+	std::unordered_map<uint64_t, PyObject *> raw_values;
+	duckdb::idx_t raw_size = 0;
+	// Lookups this chunk, to stop caching when values don't repeat
+	duckdb::idx_t lookups = 0;
+	duckdb::idx_t hits = 0;
+};
+
 PyObject *pyObjectToIterable(PyObject *py_object);
 std::vector<duckdb::LogicalType> PyTypesToLogicalTypes(const std::vector<PyObject *> &pyTypes);
 
-// Duplicates functionality of PyUnicode_AsUTF8() which is not part of the limited ABI
-char *Unicode_AsUTF8(PyObject *unicodeObject);
+// Copies the UTF-8 contents of a Python str. Uses PyUnicode_AsUTF8AndSize() when it is
+// available, which is not part of the limited ABI.
+std::string Unicode_AsUTF8(PyObject *unicodeObject);
 
 } // namespace pyudf
@@ -0,0 +1,27 @@
+#ifndef PYINFER_HPP
+#define PYINFER_HPP
+
+#include <string>
+#include <vector>
+#include <duckdb.hpp>
+#include <Python.h>
+
+namespace pyudf {
+// Detects the narrowest DuckDB type able to hold each column of a sample of rows, much like
+// read_csv's auto detection. Columns holding only None are typed as VARCHAR. Rows that carry
+// their own column names (dicts, NamedTuples, and dataclasses) have them appended to 'names',
+// which is left empty otherwise.
+//
+// 'stringified' is set for each VARCHAR column that sampled values other than str, eg because
+// values disagreed. Values in those columns are stored as their str(), see RowConverter.
+std::vector<duckdb::LogicalType> InferColumnTypes(const std::vector<PyObject *> &rows,
+                                                  std::vector<std::string> &names, std::vector<bool> &stringified);
+
+// The DuckDB type for a single Python value, SQLNULL for None
+duckdb::LogicalType InferPyObjectType(PyObject *py_item);
+
+// The narrowest type able to hold values of both 'left' and 'right', falling back to VARCHAR
+duckdb::LogicalType PromoteLogicalType(const duckdb::LogicalType &left, const duckdb::LogicalType &right);
+} // namespace pyudf
+
+#endif // PYINFER_HPP
@@ -4,4 +4,8 @@
 
 namespace pyudf {
 duckdb::CreateScalarFunctionInfo GetPythonScalarFunction();
+
+// pytables_register('name', 'module:function', arg_types, return_type), which creates a scalar
+// function 'name' with a fixed signature that calls the Python function directly
+duckdb::CreateScalarFunctionInfo GetRegisterFunction();
 }
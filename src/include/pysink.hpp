@@ -0,0 +1,12 @@
+#ifndef PYSINK_HPP
+#define PYSINK_HPP
+
+#include <duckdb.hpp>
+#include <duckdb/function/copy_function.hpp>
+
+namespace pyudf {
+// COPY (query) TO 'module:function' (FORMAT python), which hands the query's results to a Python
+// function or sink class in batches of whole columns rather than writing a file
+duckdb::CopyFunction GetPythonCopyFunction();
+} // namespace pyudf
+#endif // PYSINK_HPP
@@ -5,4 +5,6 @@
 
 namespace pyudf {
 duckdb::unique_ptr<duckdb::CreateTableFunctionInfo> GetPythonTableFunction();
+// pytable_multi('module:function', [argument sets]), the union of calling the function with each
+duckdb::unique_ptr<duckdb::CreateTableFunctionInfo> GetPythonTableMultiFunction();
 } // namespace pyudf
@@ -5,6 +5,7 @@
 #include <string>
 #include <utility>
 #include <python_exception.hpp>
+#include <pycompat.hpp>
 
 namespace pyudf {
 
@@ -19,12 +20,29 @@ public:
 
 	std::pair<PyObject *, PythonException *> call(PyObject *args) const;
 	std::pair<PyObject *, PythonException *> call(PyObject *args, PyObject *kwargs) const;
-	std::string function_name() {
+	// Positional arguments from a C array, uses vectorcall when the build allows it
+	std::pair<PyObject *, PythonException *> call(PyObject *const *args, size_t nargs) const;
+	std::pair<PyObject *, PythonException *> call(CallArguments &args) const;
+	std::string function_name() const {
 		return function_name_;
 	}
-	std::string module_name() {
+	std::string module_name() const {
 		return module_name_;
 	}
+	// Whether the function was declared with @ducktables.volatile, undeclared functions are
+	// assumed to be deterministic
+	bool declared_volatile() const {
+		return volatile_;
+	}
+	// Whether this is a class implementing the class based function protocol, see
+	// PythonUDFInstance, rather than something to call directly
+	bool udf_class() const {
+		return udf_class_;
+	}
+	// The module attribute itself, a borrowed reference
+	PyObject *callable() const {
+		return function;
+	}
 
 protected:
 	void init(const std::string &module_name, const std::string &function_name);
@@ -33,8 +51,37 @@ protected:
 private:
 	std::string module_name_;
 	std::string function_name_;
+	bool volatile_;
+	bool udf_class_;
 	PyObject *module;
 };
 
+// An instance of a class based function (eg a subclass of ducktables.ScalarUDF). Each DuckDB thread
+// constructs its own and calls setup() once, so expensive initialization like loading a model is
+// paid once per thread. The instance is then called for every row, or its process_batch() for
+// every chunk, and teardown() is called when the thread is finished with it.
+//
+// Create, call, and destroy while holding the GIL.
+class PythonUDFInstance {
+public:
+	explicit PythonUDFInstance(const PythonFunction &udf_class);
+	~PythonUDFInstance();
+	PythonUDFInstance(const PythonUDFInstance &) = delete;
+	PythonUDFInstance &operator=(const PythonUDFInstance &) = delete;
+
+	bool batched() const {
+		return process_batch != nullptr;
+	}
+	// instance(*args) for a single row
+	std::pair<PyObject *, PythonException *> call(PyObject *const *args, size_t nargs) const;
+	std::pair<PyObject *, PythonException *> call(CallArguments &args) const;
+	// instance.process_batch(*columns), each column a list holding the chunk's values
+	std::pair<PyObject *, PythonException *> call_batch(PyObject *const *columns, size_t ncolumns) const;
+
+private:
+	PyObject *instance;
+	PyObject *process_batch;
+};
+
 } // namespace pyudf
 #endif // PYTHONFUNCTION_H
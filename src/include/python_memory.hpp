@@ -0,0 +1,64 @@
+#ifndef PYTHON_MEMORY_HPP
+#define PYTHON_MEMORY_HPP
+
+#include <Python.h>
+#include <cstdint>
+#include <duckdb.hpp>
+#include <duckdb/storage/buffer_manager.hpp>
+
+namespace pyudf {
+
+// Objects created by Python code are invisible to DuckDB's buffer manager, so a table function
+// holding large pages of results could exceed memory_limit unnoticed. We measure the size of
+// Python's heap and reserve the growth with the buffer manager while a scan runs.
+//
+// Version specific builds count bytes through allocator hooks installed before the interpreter
+// starts, which costs a few nanoseconds per allocation. The limited API has no allocator hooks,
+// and they can't be installed once the interpreter is running (eg when we're loaded by the
+// duckdb Python package), so otherwise we use tracemalloc instead, which is considerably slower
+// and so is off by default (see the pytables_track_memory setting).
+
+// Installs the counting allocator hooks if this build supports them. Must be called before
+// Py_Initialize().
+void InstallPythonMemoryHooks();
+
+// Whether we can measure Python's heap, starting tracemalloc if that's how this build does it.
+// Must hold the GIL.
+bool StartPythonMemoryTracking();
+
+// Bytes currently allocated by the interpreter. Must hold the GIL.
+int64_t PythonMemoryUsage();
+
+// Default for pytables_track_memory, which is only on when tracking is cheap
+bool PythonMemoryTrackingDefault();
+
+// Whether pytables_track_memory is enabled for this connection
+bool PythonMemoryTrackingEnabled(duckdb::ClientContext &context);
+
+// True when DuckDB's memory use is close enough to memory_limit that we should stop buffering
+// Python objects ahead of their use
+bool NearMemoryLimit(duckdb::ClientContext &context);
+
+// Keeps a buffer manager reservation matching how much Python's heap has grown since the
+// reservation was created. Released when destroyed.
+class PythonMemoryReservation {
+public:
+	// Must hold the GIL
+	explicit PythonMemoryReservation(duckdb::ClientContext &context);
+	~PythonMemoryReservation();
+	PythonMemoryReservation(const PythonMemoryReservation &) = delete;
+	PythonMemoryReservation &operator=(const PythonMemoryReservation &) = delete;
+
+	// Grows or shrinks the reservation to the heap's current growth. Throws an
+	// OutOfMemoryException if DuckDB can't make room for it. Must hold the GIL.
+	void Update();
+
+private:
+	duckdb::BufferManager &buffer_manager;
+	bool enabled;
+	int64_t baseline = 0;
+	duckdb::idx_t reserved = 0;
+};
+
+} // namespace pyudf
+#endif // PYTHON_MEMORY_HPP
@@ -1,7 +1,9 @@
 
 #include "python_function.hpp"
 #include <Python.h>
+#include <deque>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 #include <duckdb.hpp>
@@ -15,7 +17,20 @@ public:
 	std::vector<duckdb::LogicalType> column_types(PyObject *args, PyObject *kwargs);
 
 private:
+	struct Schema {
+		std::vector<std::string> names;
+		std::vector<duckdb::LogicalType> types;
+	};
+	// Schemas derived from the function are cached, since they come from its annotations. The
+	// decorator is handed the call's arguments though, so they're keyed by the arguments' repr().
+	std::unordered_map<std::string, Schema> cached_schemas;
+	// Keys of the cached schemas, oldest first, for evicting them
+	std::deque<std::string> cached_order;
+	Schema schema(PyObject *args, PyObject *kwargs);
+
 	std::vector<PyObject *> pycolumn_types(PyObject *args, PyObject *kwargs);
+	std::vector<duckdb::LogicalType> pyduckdb_types(PyObject *args, PyObject *kwargs);
+	std::vector<std::string> pycolumn_names(PyObject *args, PyObject *kwargs);
 	PyObject *wrap_function(PyObject *function);
 	PyObject *import_decorator();
 };
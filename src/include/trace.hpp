@@ -0,0 +1,48 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pyudf {
+
+// Records timestamped spans (binds, Python calls, scan and pycall chunks, GIL waits) to a file
+// in the Chrome Trace Event format, viewable in chrome://tracing or Perfetto. Enabled by the
+// pytables_trace_file setting. When disabled, recording a span costs a single atomic load.
+//
+// Events are written as a JSON array without its closing bracket, which both viewers accept,
+// so a trace remains readable even if the process exits without stopping it.
+class Tracer {
+public:
+	static Tracer &Get();
+
+	inline bool Enabled() const {
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	// Starts writing to 'path', ending any trace in progress. An empty path just stops tracing.
+	void Start(const std::string &path);
+	void Stop();
+
+	// Records a span between two NowNanos() readings on the calling thread. 'function' is the
+	// 'module:function' the span belongs to, if any, and 'args' are extra counters to show.
+	void Record(const char *name, const std::string &function, uint64_t start_ns, uint64_t end_ns,
+	            const std::vector<std::pair<const char *, uint64_t>> &args = {});
+
+private:
+	Tracer() = default;
+	~Tracer();
+
+	std::atomic<bool> enabled {false};
+	std::mutex lock;
+	std::ofstream out;
+	bool first_event = true;
+};
+
+} // namespace pyudf
+#endif // TRACE_HPP
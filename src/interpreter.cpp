@@ -0,0 +1,96 @@
+#include <interpreter.hpp>
+#include <function_registry.hpp>
+#include <python_memory.hpp>
+#include <log.hpp>
+#include "config.h"
+#include <dlfcn.h>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace pyudf {
+
+static void LoadLibPython() {
+	// Python C Extensions will encounter errors about missing symbols unless
+	// we eplicitly load the entire contents of the shared library. We do this
+	// with the dlopen() function which takes the path to the shared library. This
+	// can create some issues! Most notably where is the library and/or which one
+	// should we load. Our strategy at this time is to check if the user has
+	// supplied us a path to the file via an environment variable, look up the path
+	// via reflection on one of the preloaded symbols, and finally to "guess" the
+	// file name via some heuristics.
+	const char *libpath;
+	libpath = std::getenv("LIBPYTHONSO_PATH");
+	if (!libpath) {
+		// No env variable. Try examining a preloaded symbol.
+		Dl_info info;
+		if ((dladdr((void *)Py_Initialize, &info)) && (info.dli_fname)) {
+			libpath = info.dli_fname;
+		} else {
+			// Issue doing symbol lookup, fallback to our "guess"
+			libpath = PYTHON_LIB_NAME;
+		}
+	}
+	void *libpython = dlopen(libpath, RTLD_NOW | RTLD_GLOBAL);
+	if (!libpython) {
+		std::cerr << "Failed to dyanmically load your libpython shared library: " << PYTHON_LIB_NAME
+		          << ". You may see errors about missing symbols." << std::endl;
+		auto errMsg = dlerror();
+		std::cerr << "Error Details: " << errMsg << std::endl;
+	}
+}
+
+void EnsureInterpreter() {
+	static std::once_flag started;
+	std::call_once(started, []() {
+		debug("Starting the Python interpreter");
+		// If we're loaded into a process that already runs Python (eg the duckdb Python package)
+		// the interpreter is already up, and whoever started it owns the GIL
+		if (Py_IsInitialized()) {
+			return;
+		}
+		InstallPythonMemoryHooks();
+		Py_Initialize();
+		LoadLibPython();
+		// Py_Initialize() leaves this thread holding the GIL. Release it so queries running
+		// on any of DuckDB's threads can take it via GILGuard.
+		PyEval_SaveThread();
+	});
+}
+
+std::vector<std::string> ParseModuleList(const std::string &module_list) {
+	std::vector<std::string> module_names;
+	std::stringstream stream(module_list);
+	std::string entry;
+	while (std::getline(stream, entry, ',')) {
+		auto start = entry.find_first_not_of(" \t\n");
+		if (start == std::string::npos) {
+			continue;
+		}
+		auto end = entry.find_last_not_of(" \t\n");
+		module_names.push_back(entry.substr(start, end - start + 1));
+	}
+	return module_names;
+}
+
+void PreloadModules(const std::vector<std::string> &module_names) {
+	if (module_names.empty()) {
+		return;
+	}
+	std::thread([module_names]() {
+		GILGuard gil;
+		for (auto &module_name : module_names) {
+			try {
+				FunctionRegistry::Get().Preload(module_name);
+				debug("Preloaded module " + module_name);
+			} catch (std::exception &e) {
+				debug("Failed to preload module " + module_name + ": " + e.what());
+			}
+		}
+	}).detach();
+}
+
+} // namespace pyudf
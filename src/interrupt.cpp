@@ -0,0 +1,183 @@
+#include <interrupt.hpp>
+#include <function_stats.hpp>
+#include <log.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <duckdb/common/exception.hpp>
+
+namespace pyudf {
+
+// How often the watchdog looks for cancelled queries and expired calls while any are running
+static const std::chrono::milliseconds WATCH_INTERVAL(2);
+
+enum Interruption : int { NOT_INTERRUPTED = 0, CANCELLED = 1, TIMED_OUT = 2 };
+
+// One per thread that has run Python on behalf of a query. Never freed, DuckDB's thread pool
+// keeps the number of these small.
+struct WatchedThread {
+	unsigned long thread_id;
+	std::atomic<bool> active {false};
+	// Deadline of the call in progress as a NowNanos() reading, 0 if none
+	std::atomic<uint64_t> deadline {0};
+	std::atomic<int> interruption {NOT_INTERRUPTED};
+	// Shared so the watchdog can inspect it without racing the query finishing
+	std::mutex context_lock;
+	std::shared_ptr<duckdb::ClientContext> context;
+	uint64_t timeout_ms = 0;
+};
+
+class Watchdog {
+public:
+	static Watchdog &Get() {
+		// Intentionally leaked, the thread runs until the process exits
+		static Watchdog *watchdog = new Watchdog();
+		return *watchdog;
+	}
+
+	WatchedThread &CurrentThread() {
+		thread_local WatchedThread *current = nullptr;
+		if (!current) {
+			current = new WatchedThread();
+			current->thread_id = PyThread_get_thread_ident();
+			std::lock_guard<std::mutex> guard(lock);
+			threads.push_back(current);
+		}
+		return *current;
+	}
+
+	void Activate() {
+		std::lock_guard<std::mutex> guard(lock);
+		if (!started) {
+			std::thread([this]() { Run(); }).detach();
+			started = true;
+		}
+		if (active_watches++ == 0) {
+			wake.notify_one();
+		}
+	}
+
+	void Deactivate() {
+		std::lock_guard<std::mutex> guard(lock);
+		active_watches--;
+	}
+
+private:
+	Watchdog() = default;
+
+	static Interruption Due(WatchedThread &thread) {
+		{
+			std::lock_guard<std::mutex> guard(thread.context_lock);
+			if (thread.context && thread.context->interrupted) {
+				return CANCELLED;
+			}
+		}
+		auto deadline = thread.deadline.load();
+		if (deadline && NowNanos() > deadline) {
+			return TIMED_OUT;
+		}
+		return NOT_INTERRUPTED;
+	}
+
+	static void Interrupt(WatchedThread &thread) {
+		// Calls start and finish while holding the GIL, so once we hold it the thread is either
+		// still inside the call we're interrupting or has moved on, in which case we must not.
+		PyGILState_STATE gil = PyGILState_Ensure();
+		auto reason = thread.active ? Due(thread) : NOT_INTERRUPTED;
+		if (reason != NOT_INTERRUPTED && thread.interruption == NOT_INTERRUPTED) {
+			thread.interruption = reason;
+			PyThreadState_SetAsyncExc(thread.thread_id, PyExc_KeyboardInterrupt);
+		}
+		PyGILState_Release(gil);
+	}
+
+	void Run() {
+		std::unique_lock<std::mutex> guard(lock);
+		while (true) {
+			wake.wait(guard, [this]() { return active_watches > 0; });
+			auto watched = threads;
+			guard.unlock();
+			std::this_thread::sleep_for(WATCH_INTERVAL);
+			for (auto thread : watched) {
+				if (thread->active && thread->interruption == NOT_INTERRUPTED && Due(*thread) != NOT_INTERRUPTED) {
+					Interrupt(*thread);
+				}
+			}
+			guard.lock();
+		}
+	}
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::vector<WatchedThread *> threads;
+	int active_watches = 0;
+	bool started = false;
+};
+
+PythonCallWatch::PythonCallWatch(duckdb::ClientContext &context, uint64_t timeout_ms)
+    : thread(Watchdog::Get().CurrentThread()), timeout_ns(timeout_ms * 1000000) {
+	{
+		std::lock_guard<std::mutex> guard(thread.context_lock);
+		thread.context = context.shared_from_this();
+	}
+	thread.timeout_ms = timeout_ms;
+	thread.interruption = NOT_INTERRUPTED;
+	thread.active = true;
+	Watchdog::Get().Activate();
+}
+
+PythonCallWatch::~PythonCallWatch() {
+	thread.deadline = 0;
+	thread.active = false;
+	if (thread.interruption != NOT_INTERRUPTED) {
+		// The exception may not have been raised yet if the call returned first, don't let it
+		// surface in whatever Python code this thread runs next
+		PyThreadState_SetAsyncExc(thread.thread_id, nullptr);
+		thread.interruption = NOT_INTERRUPTED;
+	}
+	{
+		std::lock_guard<std::mutex> guard(thread.context_lock);
+		thread.context.reset();
+	}
+	Watchdog::Get().Deactivate();
+}
+
+void PythonCallWatch::BeginCall() {
+	if (timeout_ns) {
+		thread.deadline = NowNanos() + timeout_ns;
+	}
+}
+
+void PythonCallWatch::EndCall() {
+	if (timeout_ns) {
+		thread.deadline = 0;
+	}
+}
+
+void PythonCallWatch::ThrowIfInterrupted(const std::string &function) {
+	auto reason = thread.interruption.load();
+	if (reason == NOT_INTERRUPTED) {
+		return;
+	}
+	PyErr_Clear();
+	if (reason == CANCELLED) {
+		throw duckdb::InterruptException();
+	}
+	throw std::runtime_error("Python function '" + function + "' timed out after " +
+	                         std::to_string(thread.timeout_ms) + "ms");
+}
+
+uint64_t PythonTimeoutMillis(duckdb::ClientContext &context) {
+	duckdb::Value timeout;
+	if (!context.TryGetCurrentSetting("pytables_timeout_ms", timeout) || timeout.IsNull()) {
+		return 0;
+	}
+	auto timeout_ms = timeout.GetValue<int64_t>();
+	return timeout_ms > 0 ? (uint64_t)timeout_ms : 0;
+}
+
+} // namespace pyudf
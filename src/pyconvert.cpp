@@ -1,16 +1,930 @@
-
 #include <pyconvert.hpp>
+#include <pycompat.hpp>
 #include <duckdb.hpp>
+#include <duckdb/common/types/date.hpp>
+#include <duckdb/common/types/decimal.hpp>
+#include <duckdb/common/types/time.hpp>
+#include <duckdb/common/types/timestamp.hpp>
+#include <duckdb/common/types/hugeint.hpp>
+#include <duckdb/common/types/uuid.hpp>
+#include <duckdb/common/string_map_set.hpp>
 #include <Python.h>
+#ifndef Py_LIMITED_API
+#include <structmember.h>
+#endif
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <unordered_map>
 #include <log.hpp>
 
 namespace pyudf {
 
+static PyObject *ImportAttr(const char *module_name, const char *attr_name) {
+	PyObject *module = PyImport_ImportModule(module_name);
+	if (!module) {
+		PyErr_Print();
+		throw std::runtime_error("Failed to import module: " + std::string(module_name));
+	}
+	PyObject *attr = PyObject_GetAttrString(module, attr_name);
+	Py_DECREF(module);
+	if (!attr) {
+		PyErr_Print();
+		throw std::runtime_error("Failed to find attribute: " + std::string(attr_name));
+	}
+	return attr;
+}
+
+PyTypeCache &PyTypes() {
+	static PyTypeCache *cache = nullptr;
+	if (!cache) {
+		auto types = new PyTypeCache();
+		types->date = ImportAttr("datetime", "date");
+		types->datetime = ImportAttr("datetime", "datetime");
+		types->time = ImportAttr("datetime", "time");
+		types->timedelta = ImportAttr("datetime", "timedelta");
+		PyObject *timezone = ImportAttr("datetime", "timezone");
+		types->timezone_utc = PyObject_GetAttrString(timezone, "utc");
+		Py_DECREF(timezone);
+		types->decimal = ImportAttr("decimal", "Decimal");
+		PyObject *context_class = ImportAttr("decimal", "Context");
+		PyObject *context_args = PyTuple_New(0);
+		PyObject *context_kwargs = Py_BuildValue("{s:i}", "prec", duckdb::Decimal::MAX_WIDTH_DECIMAL);
+		types->decimal_context = PyObject_Call(context_class, context_args, context_kwargs);
+		Py_DECREF(context_kwargs);
+		Py_DECREF(context_args);
+		Py_DECREF(context_class);
+		types->uuid = ImportAttr("uuid", "UUID");
+		if (!types->timezone_utc || !types->decimal_context) {
+			PyErr_Print();
+			throw std::runtime_error("Failed to initialize Python type conversions");
+		}
+		cache = types;
+	}
+	return *cache;
+}
+
+bool IsInstance(PyObject *py_item, PyObject *py_class) {
+	int result = PyObject_IsInstance(py_item, py_class);
+	if (result < 0) {
+		PyErr_Clear();
+		return false;
+	}
+	return result == 1;
+}
+
+static bool GetIntAttr(PyObject *py_item, const char *name, int32_t &result) {
+	PyObject *attr = PyObject_GetAttrString(py_item, name);
+	if (!attr) {
+		PyErr_Clear();
+		return false;
+	}
+	long value = PyLong_AsLong(attr);
+	Py_DECREF(attr);
+	if (value == -1 && PyErr_Occurred()) {
+		PyErr_Clear();
+		return false;
+	}
+	result = (int32_t)value;
+	return true;
+}
+
+// Splits a Python int into its upper 64 bits (arithmetic shift, so the sign is preserved) and its
+// lower 64 bits. Both results are new references.
+static bool SplitPyLong(PyObject *py_long, PyObject *&upper, PyObject *&lower) {
+	PyObject *shift = PyLong_FromLong(64);
+	PyObject *mask = PyLong_FromUnsignedLongLong(std::numeric_limits<uint64_t>::max());
+	upper = PyNumber_Rshift(py_long, shift);
+	lower = PyNumber_And(py_long, mask);
+	Py_DECREF(shift);
+	Py_DECREF(mask);
+	if (!upper || !lower) {
+		Py_XDECREF(upper);
+		Py_XDECREF(lower);
+		PyErr_Clear();
+		return false;
+	}
+	return true;
+}
+
+static bool PyLongToHugeint(PyObject *py_long, duckdb::hugeint_t &result) {
+	int overflow;
+	long long value = PyLong_AsLongLongAndOverflow(py_long, &overflow);
+	if (value == -1 && PyErr_Occurred()) {
+		PyErr_Clear();
+		return false;
+	}
+	if (!overflow) {
+		result = duckdb::hugeint_t((int64_t)value);
+		return true;
+	}
+
+	PyObject *upper, *lower;
+	if (!SplitPyLong(py_long, upper, lower)) {
+		return false;
+	}
+	long long upper_value = PyLong_AsLongLongAndOverflow(upper, &overflow);
+	unsigned long long lower_value = PyLong_AsUnsignedLongLong(lower);
+	Py_DECREF(upper);
+	Py_DECREF(lower);
+	if (overflow || PyErr_Occurred()) {
+		PyErr_Clear();
+		return false;
+	}
+	result.upper = upper_value;
+	result.lower = lower_value;
+	return true;
+}
+
+static PyObject *HugeintToPyLong(duckdb::hugeint_t value) {
+	if (value.upper == 0) {
+		return PyLong_FromUnsignedLongLong(value.lower);
+	} else if (value.upper == -1 && (value.lower >> 63)) {
+		return PyLong_FromLongLong((int64_t)value.lower);
+	}
+	PyObject *upper = PyLong_FromLongLong(value.upper);
+	PyObject *lower = PyLong_FromUnsignedLongLong(value.lower);
+	PyObject *shift = PyLong_FromLong(64);
+	PyObject *shifted = PyNumber_Lshift(upper, shift);
+	PyObject *result = PyNumber_Or(shifted, lower);
+	Py_DECREF(upper);
+	Py_DECREF(lower);
+	Py_DECREF(shift);
+	Py_DECREF(shifted);
+	return result;
+}
+
+// DuckDB stores UUIDs as a hugeint with the top bit flipped so they sort in the same order as
+// their string representation.
+static bool PyUUIDToHugeint(PyObject *py_item, duckdb::hugeint_t &result) {
+	PyObject *py_int = PyObject_GetAttrString(py_item, "int");
+	if (!py_int) {
+		PyErr_Clear();
+		return false;
+	}
+	PyObject *upper, *lower;
+	bool success = SplitPyLong(py_int, upper, lower);
+	Py_DECREF(py_int);
+	if (!success) {
+		return false;
+	}
+	unsigned long long upper_value = PyLong_AsUnsignedLongLong(upper);
+	unsigned long long lower_value = PyLong_AsUnsignedLongLong(lower);
+	Py_DECREF(upper);
+	Py_DECREF(lower);
+	if (PyErr_Occurred()) {
+		PyErr_Clear();
+		return false;
+	}
+	result.upper = (int64_t)(upper_value ^ (uint64_t(1) << 63));
+	result.lower = lower_value;
+	return true;
+}
+
+static PyObject *HugeintToPyUUID(duckdb::hugeint_t value) {
+	PyObject *upper = PyLong_FromUnsignedLongLong(uint64_t(value.upper) ^ (uint64_t(1) << 63));
+	PyObject *lower = PyLong_FromUnsignedLongLong(value.lower);
+	PyObject *shift = PyLong_FromLong(64);
+	PyObject *shifted = PyNumber_Lshift(upper, shift);
+	PyObject *py_int = PyNumber_Or(shifted, lower);
+	Py_DECREF(upper);
+	Py_DECREF(lower);
+	Py_DECREF(shift);
+	Py_DECREF(shifted);
+
+	PyObject *args = PyTuple_New(0);
+	PyObject *kwargs = PyDict_New();
+	PyDict_SetItemString(kwargs, "int", py_int);
+	PyObject *result = PyObject_Call(PyTypes().uuid, args, kwargs);
+	Py_DECREF(py_int);
+	Py_DECREF(args);
+	Py_DECREF(kwargs);
+	return result;
+}
+
+static bool PyTimedeltaToMicros(PyObject *py_item, int32_t &days, int64_t &micros) {
+	int32_t seconds, microseconds;
+	if (!GetIntAttr(py_item, "days", days) || !GetIntAttr(py_item, "seconds", seconds) ||
+	    !GetIntAttr(py_item, "microseconds", microseconds)) {
+		return false;
+	}
+	micros = int64_t(seconds) * duckdb::Interval::MICROS_PER_SEC + microseconds;
+	return true;
+}
+
+static bool PyDateToDate(PyObject *py_item, duckdb::date_t &result) {
+	int32_t year, month, day;
+	if (!IsInstance(py_item, PyTypes().date) || !GetIntAttr(py_item, "year", year) ||
+	    !GetIntAttr(py_item, "month", month) || !GetIntAttr(py_item, "day", day)) {
+		return false;
+	}
+	result = duckdb::Date::FromDate(year, month, day);
+	return true;
+}
+
+static bool PyTimeToTime(PyObject *py_item, duckdb::dtime_t &result) {
+	int32_t hour, minute, second, microsecond;
+	if (!GetIntAttr(py_item, "hour", hour) || !GetIntAttr(py_item, "minute", minute) ||
+	    !GetIntAttr(py_item, "second", second) || !GetIntAttr(py_item, "microsecond", microsecond)) {
+		return false;
+	}
+	result = duckdb::Time::FromTime(hour, minute, second, microsecond);
+	return true;
+}
+
+// Converts a datetime (or a date, taken as midnight) to microseconds since the epoch. Timezone
+// aware values are normalized to UTC.
+static bool PyDateTimeToTimestamp(PyObject *py_item, duckdb::timestamp_t &result) {
+	duckdb::date_t date;
+	if (!PyDateToDate(py_item, date)) {
+		return false;
+	}
+	if (!IsInstance(py_item, PyTypes().datetime)) {
+		result = duckdb::Timestamp::FromDatetime(date, duckdb::dtime_t(0));
+		return true;
+	}
+	duckdb::dtime_t time;
+	if (!PyTimeToTime(py_item, time)) {
+		return false;
+	}
+	result = duckdb::Timestamp::FromDatetime(date, time);
+
+	PyObject *offset = PyObject_CallMethod(py_item, "utcoffset", nullptr);
+	if (!offset) {
+		PyErr_Clear();
+		return false;
+	}
+	bool success = true;
+	if (offset != Py_None) {
+		int32_t days;
+		int64_t micros;
+		success = PyTimedeltaToMicros(offset, days, micros);
+		result = duckdb::timestamp_t(result.value - (int64_t(days) * duckdb::Interval::MICROS_PER_DAY + micros));
+	}
+	Py_DECREF(offset);
+	return success;
+}
+
+// Produces the unscaled integer value of a Decimal, int, or float for a DECIMAL(width, scale) column.
+static bool PyToDecimal(PyObject *py_item, uint8_t width, uint8_t scale, duckdb::hugeint_t &result) {
+	auto &types = PyTypes();
+	PyObject *decimal;
+	if (IsInstance(py_item, types.decimal)) {
+		decimal = py_item;
+		Py_INCREF(decimal);
+	} else if ((PyLong_Check(py_item) && !PyBool_Check(py_item)) || PyFloat_Check(py_item)) {
+		decimal = PyObject_CallFunctionObjArgs(types.decimal, py_item, nullptr);
+	} else {
+		return false;
+	}
+	if (!decimal) {
+		PyErr_Clear();
+		return false;
+	}
+
+	PyObject *scaled = PyObject_CallMethod(decimal, "scaleb", "iO", (int)scale, types.decimal_context);
+	Py_DECREF(decimal);
+	if (!scaled) {
+		PyErr_Clear();
+		return false;
+	}
+	PyObject *integral = PyObject_CallMethod(scaled, "to_integral_value", nullptr);
+	Py_DECREF(scaled);
+	if (!integral) {
+		PyErr_Clear();
+		return false;
+	}
+	// Fails for NaN and Infinity
+	PyObject *py_long = PyNumber_Long(integral);
+	Py_DECREF(integral);
+	if (!py_long) {
+		PyErr_Clear();
+		return false;
+	}
+	bool success = PyLongToHugeint(py_long, result);
+	Py_DECREF(py_long);
+
+	auto &limit = duckdb::Hugeint::POWERS_OF_TEN[width];
+	return success && result < limit && result > (duckdb::hugeint_t(0) - limit);
+}
+
+template <class T>
+static bool WriteInteger(PyObject *py_item, duckdb::Vector &result, duckdb::idx_t row) {
+	if (!PyLong_Check(py_item)) {
+		return false;
+	}
+	int overflow;
+	long long value = PyLong_AsLongLongAndOverflow(py_item, &overflow);
+	if (value == -1 && PyErr_Occurred()) {
+		PyErr_Clear();
+		return false;
+	}
+	if (overflow || value < (long long)std::numeric_limits<T>::min() ||
+	    value > (long long)std::numeric_limits<T>::max()) {
+		return false;
+	}
+	duckdb::FlatVector::GetData<T>(result)[row] = (T)value;
+	return true;
+}
+
+static bool WriteString(PyObject *py_item, duckdb::Vector &result, duckdb::idx_t row) {
+	if (!PyUnicode_Check(py_item)) {
+		return false;
+	}
+	UTF8View utf8(py_item);
+	if (!utf8.IsValid()) {
+		return false;
+	}
+	duckdb::FlatVector::GetData<duckdb::string_t>(result)[row] =
+	    duckdb::StringVector::AddString(result, utf8.data, utf8.size);
+	return true;
+}
+
+static bool WriteBlob(PyObject *py_item, duckdb::Vector &result, duckdb::idx_t row) {
+	char *data;
+	Py_ssize_t size;
+	if (PyBytes_Check(py_item)) {
+		if (PyBytes_AsStringAndSize(py_item, &data, &size) < 0) {
+			PyErr_Clear();
+			return false;
+		}
+	} else if (PyByteArray_Check(py_item)) {
+		data = PyByteArray_AsString(py_item);
+		size = PyByteArray_Size(py_item);
+	} else {
+		return false;
+	}
+	duckdb::FlatVector::GetData<duckdb::string_t>(result)[row] =
+	    duckdb::StringVector::AddStringOrBlob(result, duckdb::string_t(data, size));
+	return true;
+}
+
+static bool WriteList(PyObject *py_item, const duckdb::LogicalType &logical_type, duckdb::Vector &result,
+                      duckdb::idx_t row) {
+	if (!PyList_Check(py_item) && !PyTuple_Check(py_item)) {
+		return false;
+	}
+	auto size = (duckdb::idx_t)PySequence_Size(py_item);
+	auto offset = duckdb::ListVector::GetListSize(result);
+	duckdb::ListVector::Reserve(result, offset + size);
+	auto &child = duckdb::ListVector::GetEntry(result);
+	auto &child_type = duckdb::ListType::GetChildType(logical_type);
+	bool converted = true;
+	for (duckdb::idx_t i = 0; i < size; i++) {
+		// Borrowed reference
+		PyObject *py_child = FastSequenceItem(py_item, i);
+		converted &= ConvertPyObjectToVector(py_child, child_type, child, offset + i);
+	}
+	duckdb::ListVector::SetListSize(result, offset + size);
+	auto &entry = duckdb::FlatVector::GetData<duckdb::list_entry_t>(result)[row];
+	entry.offset = offset;
+	entry.length = size;
+	return converted;
+}
+
+static bool WriteMap(PyObject *py_item, const duckdb::LogicalType &logical_type, duckdb::Vector &result,
+                     duckdb::idx_t row) {
+	if (!PyDict_Check(py_item)) {
+		return false;
+	}
+	auto size = (duckdb::idx_t)PyDict_Size(py_item);
+	auto offset = duckdb::ListVector::GetListSize(result);
+	duckdb::ListVector::Reserve(result, offset + size);
+	auto &keys = duckdb::MapVector::GetKeys(result);
+	auto &values = duckdb::MapVector::GetValues(result);
+	auto &key_type = duckdb::MapType::KeyType(logical_type);
+	auto &value_type = duckdb::MapType::ValueType(logical_type);
+
+	Py_ssize_t pos = 0;
+	PyObject *py_key, *py_value;
+	duckdb::idx_t index = offset;
+	bool converted = true;
+	while (PyDict_Next(py_item, &pos, &py_key, &py_value)) {
+		converted &= ConvertPyObjectToVector(py_key, key_type, keys, index);
+		converted &= ConvertPyObjectToVector(py_value, value_type, values, index);
+		index++;
+	}
+	duckdb::ListVector::SetListSize(result, offset + size);
+	auto &entry = duckdb::FlatVector::GetData<duckdb::list_entry_t>(result)[row];
+	entry.offset = offset;
+	entry.length = size;
+	return converted;
+}
+
+static bool WriteStruct(PyObject *py_item, const duckdb::LogicalType &logical_type, duckdb::Vector &result,
+                        duckdb::idx_t row) {
+	auto &entries = duckdb::StructVector::GetEntries(result);
+	auto &child_types = duckdb::StructType::GetChildTypes(logical_type);
+	bool converted = true;
+	if (PyDict_Check(py_item)) {
+		// Fields are matched by name, anything missing from the dict is NULL
+		for (duckdb::idx_t i = 0; i < child_types.size(); i++) {
+			PyObject *py_child = PyDict_GetItemString(py_item, child_types[i].first.c_str());
+			converted &=
+			    ConvertPyObjectToVector(py_child ? py_child : Py_None, child_types[i].second, *entries[i], row);
+		}
+		return converted;
+	} else if (PyTuple_Check(py_item) || PyList_Check(py_item)) {
+		// Fields are matched by position
+		if ((duckdb::idx_t)PySequence_Size(py_item) != child_types.size()) {
+			return false;
+		}
+		for (duckdb::idx_t i = 0; i < child_types.size(); i++) {
+			PyObject *py_child = FastSequenceItem(py_item, i);
+			converted &= ConvertPyObjectToVector(py_child, child_types[i].second, *entries[i], row);
+		}
+		return converted;
+	}
+	// Any other object, such as a dataclass, has its fields read as attributes
+	bool found = false;
+	for (duckdb::idx_t i = 0; i < child_types.size(); i++) {
+		PyObject *py_child = PyObject_GetAttrString(py_item, child_types[i].first.c_str());
+		if (!py_child) {
+			PyErr_Clear();
+			duckdb::FlatVector::SetNull(*entries[i], row, true);
+			continue;
+		}
+		found = true;
+		converted &= ConvertPyObjectToVector(py_child, child_types[i].second, *entries[i], row);
+		Py_DECREF(py_child);
+	}
+	return found && converted;
+}
+
+bool ConvertPyObjectToVector(PyObject *py_item, const duckdb::LogicalType &logical_type, duckdb::Vector &result,
+                             duckdb::idx_t row) {
+	if (py_item == Py_None) {
+		duckdb::FlatVector::SetNull(result, row, true);
+		return true;
+	}
+
+	bool converted = false;
+	switch (logical_type.id()) {
+	case duckdb::LogicalTypeId::BOOLEAN:
+		if (PyBool_Check(py_item)) {
+			duckdb::FlatVector::GetData<bool>(result)[row] = (Py_True == py_item);
+			converted = true;
+		}
+		break;
+	case duckdb::LogicalTypeId::TINYINT:
+		converted = WriteInteger<int8_t>(py_item, result, row);
+		break;
+	case duckdb::LogicalTypeId::SMALLINT:
+		converted = WriteInteger<int16_t>(py_item, result, row);
+		break;
+	case duckdb::LogicalTypeId::INTEGER:
+		converted = WriteInteger<int32_t>(py_item, result, row);
+		break;
+	case duckdb::LogicalTypeId::BIGINT:
+		converted = WriteInteger<int64_t>(py_item, result, row);
+		break;
+	case duckdb::LogicalTypeId::UTINYINT:
+		converted = WriteInteger<uint8_t>(py_item, result, row);
+		break;
+	case duckdb::LogicalTypeId::USMALLINT:
+		converted = WriteInteger<uint16_t>(py_item, result, row);
+		break;
+	case duckdb::LogicalTypeId::UINTEGER:
+		converted = WriteInteger<uint32_t>(py_item, result, row);
+		break;
+	case duckdb::LogicalTypeId::UBIGINT:
+		if (PyLong_Check(py_item)) {
+			unsigned long long value = PyLong_AsUnsignedLongLong(py_item);
+			if (PyErr_Occurred()) {
+				PyErr_Clear();
+			} else {
+				duckdb::FlatVector::GetData<uint64_t>(result)[row] = value;
+				converted = true;
+			}
+		}
+		break;
+	case duckdb::LogicalTypeId::HUGEINT:
+		if (PyLong_Check(py_item)) {
+			converted = PyLongToHugeint(py_item, duckdb::FlatVector::GetData<duckdb::hugeint_t>(result)[row]);
+		}
+		break;
+	case duckdb::LogicalTypeId::FLOAT:
+	case duckdb::LogicalTypeId::DOUBLE:
+		// Decimals end up here when a detected column mixes them with floats, or they're too wide or
+		// special (NaN, Infinity) for a DECIMAL. PyFloat_AsDouble() goes through their __float__.
+		if (PyFloat_Check(py_item) || PyLong_Check(py_item) || IsInstance(py_item, PyTypes().decimal)) {
+			double value = PyFloat_AsDouble(py_item);
+			if (value == -1.0 && PyErr_Occurred()) {
+				PyErr_Clear();
+			} else if (logical_type.id() == duckdb::LogicalTypeId::FLOAT) {
+				duckdb::FlatVector::GetData<float>(result)[row] = (float)value;
+				converted = true;
+			} else {
+				duckdb::FlatVector::GetData<double>(result)[row] = value;
+				converted = true;
+			}
+		}
+		break;
+	case duckdb::LogicalTypeId::DECIMAL: {
+		duckdb::hugeint_t value;
+		if (PyToDecimal(py_item, duckdb::DecimalType::GetWidth(logical_type),
+		                duckdb::DecimalType::GetScale(logical_type), value)) {
+			converted = true;
+			switch (logical_type.InternalType()) {
+			case duckdb::PhysicalType::INT16:
+				duckdb::FlatVector::GetData<int16_t>(result)[row] = (int16_t)(int64_t)value.lower;
+				break;
+			case duckdb::PhysicalType::INT32:
+				duckdb::FlatVector::GetData<int32_t>(result)[row] = (int32_t)(int64_t)value.lower;
+				break;
+			case duckdb::PhysicalType::INT64:
+				duckdb::FlatVector::GetData<int64_t>(result)[row] = (int64_t)value.lower;
+				break;
+			default:
+				duckdb::FlatVector::GetData<duckdb::hugeint_t>(result)[row] = value;
+			}
+		}
+		break;
+	}
+	case duckdb::LogicalTypeId::VARCHAR:
+		converted = WriteString(py_item, result, row);
+		break;
+	case duckdb::LogicalTypeId::BLOB:
+		converted = WriteBlob(py_item, result, row);
+		break;
+	case duckdb::LogicalTypeId::UUID:
+		if (PyUnicode_Check(py_item)) {
+			UTF8View utf8(py_item);
+			if (utf8.IsValid()) {
+				converted = duckdb::UUID::FromString(std::string(utf8.data, utf8.size),
+				                                     duckdb::FlatVector::GetData<duckdb::hugeint_t>(result)[row]);
+			}
+		} else if (IsInstance(py_item, PyTypes().uuid)) {
+			converted = PyUUIDToHugeint(py_item, duckdb::FlatVector::GetData<duckdb::hugeint_t>(result)[row]);
+		}
+		break;
+	case duckdb::LogicalTypeId::DATE:
+		converted = PyDateToDate(py_item, duckdb::FlatVector::GetData<duckdb::date_t>(result)[row]);
+		break;
+	case duckdb::LogicalTypeId::TIME:
+		if (IsInstance(py_item, PyTypes().time)) {
+			converted = PyTimeToTime(py_item, duckdb::FlatVector::GetData<duckdb::dtime_t>(result)[row]);
+		}
+		break;
+	case duckdb::LogicalTypeId::INTERVAL:
+		if (IsInstance(py_item, PyTypes().timedelta)) {
+			auto &interval = duckdb::FlatVector::GetData<duckdb::interval_t>(result)[row];
+			interval.months = 0;
+			converted = PyTimedeltaToMicros(py_item, interval.days, interval.micros);
+		}
+		break;
+	case duckdb::LogicalTypeId::TIMESTAMP:
+	case duckdb::LogicalTypeId::TIMESTAMP_TZ:
+	case duckdb::LogicalTypeId::TIMESTAMP_SEC:
+	case duckdb::LogicalTypeId::TIMESTAMP_MS:
+	case duckdb::LogicalTypeId::TIMESTAMP_NS: {
+		duckdb::timestamp_t value;
+		if (PyDateTimeToTimestamp(py_item, value)) {
+			converted = true;
+			auto data = duckdb::FlatVector::GetData<int64_t>(result);
+			if (logical_type.id() == duckdb::LogicalTypeId::TIMESTAMP_SEC) {
+				data[row] = value.value / duckdb::Interval::MICROS_PER_SEC;
+			} else if (logical_type.id() == duckdb::LogicalTypeId::TIMESTAMP_MS) {
+				data[row] = value.value / duckdb::Interval::MICROS_PER_MSEC;
+			} else if (logical_type.id() == duckdb::LogicalTypeId::TIMESTAMP_NS) {
+				data[row] = value.value * 1000;
+			} else {
+				data[row] = value.value;
+			}
+		}
+		break;
+	}
+	case duckdb::LogicalTypeId::LIST:
+		converted = WriteList(py_item, logical_type, result, row);
+		break;
+	case duckdb::LogicalTypeId::MAP:
+		converted = WriteMap(py_item, logical_type, result, row);
+		break;
+	case duckdb::LogicalTypeId::STRUCT:
+		converted = WriteStruct(py_item, logical_type, result, row);
+		break;
+	default:
+		debug("Unhandled Logical Type: " + logical_type.ToString());
+	}
+
+	if (!converted) {
+		duckdb::FlatVector::SetNull(result, row, true);
+	}
+	return converted;
+}
+
+duckdb::idx_t ConvertPyRowToChunk(PyObject *py_row, const std::vector<duckdb::LogicalType> &logical_types,
+                                  duckdb::DataChunk &output, duckdb::idx_t row) {
+	// Tuples and lists come back as is, anything else iterable is materialized into a list
+	PyObject *py_seq = PySequence_Fast(py_row, "Row record not iterable as expected");
+	if (!py_seq) {
+		PyErr_Clear();
+		throw std::runtime_error("Error: Row record not iterable as expected");
+	}
+
+	auto size = (size_t)FastSequenceSize(py_seq);
+	if (size != logical_types.size()) {
+		Py_DECREF(py_seq);
+		auto error_message = "A row with " + std::to_string(size) + " values was detected though " +
+		                     std::to_string(logical_types.size()) + " columns were expected";
+		throw duckdb::InvalidInputException(error_message);
+	}
+
+	duckdb::idx_t failed = 0;
+	for (size_t i = 0; i < size; i++) {
+		// Borrowed reference
+		PyObject *py_item = FastSequenceItem(py_seq, i);
+		failed += !ConvertPyObjectToVector(py_item, logical_types[i], output.data[i], row);
+	}
+	Py_DECREF(py_seq);
+	return failed;
+}
+
+// Past this many distinct values a dictionary can't be less than half the size of the chunk, so
+// there's no point looking values up any more
+static const duckdb::idx_t MAX_DICTIONARY_SIZE = STANDARD_VECTOR_SIZE / 2;
+
+struct StringColumn {
+	// Keyed by identity. A reference is held so the address can't be reused by another object.
+	std::unordered_map<PyObject *, uint32_t> by_object;
+	// Keyed by value, for equal strings that are separate objects
+	duckdb::string_map_t<uint32_t> by_value;
+	// Distinct values, stored in the chunk's vector, and which of them each row holds
+	std::vector<duckdb::string_t> dictionary;
+	duckdb::SelectionVector sel;
+	// The dictionary entry standing in for NULL, if there were any
+	int64_t null_index = -1;
+	// Set once a value other than a str or None turns up, or there are too many distinct values.
+	// The rest of the chunk is written as usual and it isn't turned into a dictionary.
+	bool flat_only = false;
+	// Store the str() of values that aren't a str, rather than NULL
+	bool stringify;
+
+	explicit StringColumn(bool stringify) : stringify(stringify) {
+		Clear();
+	}
+	~StringColumn() {
+		Clear();
+	}
+
+	void Clear() {
+		for (auto &entry : by_object) {
+			Py_DECREF(entry.first);
+		}
+		by_object.clear();
+		by_value.clear();
+		dictionary.clear();
+		// A fresh selection each chunk, as the previous chunk's dictionary vector shares it
+		sel.Initialize(STANDARD_VECTOR_SIZE);
+		null_index = -1;
+		flat_only = false;
+	}
+
+	bool WriteFlat(PyObject *py_item, duckdb::Vector &result, duckdb::idx_t row) {
+		if (!stringify || py_item == Py_None || PyUnicode_Check(py_item)) {
+			return ConvertPyObjectToVector(py_item, duckdb::LogicalType::VARCHAR, result, row);
+		}
+		PyObject *py_str = PyObject_Str(py_item);
+		if (!py_str) {
+			PyErr_Clear();
+			duckdb::FlatVector::SetNull(result, row, true);
+			return false;
+		}
+		bool converted = ConvertPyObjectToVector(py_str, duckdb::LogicalType::VARCHAR, result, row);
+		Py_DECREF(py_str);
+		return converted;
+	}
+
+	bool Write(PyObject *py_item, duckdb::Vector &result, duckdb::idx_t row) {
+		if (flat_only) {
+			return WriteFlat(py_item, result, row);
+		}
+		if (py_item == Py_None) {
+			if (null_index < 0) {
+				null_index = dictionary.size();
+				dictionary.push_back(duckdb::string_t("", 0));
+			}
+			duckdb::FlatVector::SetNull(result, row, true);
+			sel.set_index(row, null_index);
+			return true;
+		}
+		if (!PyUnicode_Check(py_item)) {
+			flat_only = true;
+			return WriteFlat(py_item, result, row);
+		}
+
+		uint32_t index;
+		auto known_object = by_object.find(py_item);
+		if (known_object != by_object.end()) {
+			index = known_object->second;
+		} else {
+			UTF8View utf8(py_item);
+			if (!utf8.IsValid()) {
+				flat_only = true;
+				duckdb::FlatVector::SetNull(result, row, true);
+				return false;
+			}
+			auto known_value = by_value.find(duckdb::string_t(utf8.data, utf8.size));
+			if (known_value != by_value.end()) {
+				index = known_value->second;
+			} else if (dictionary.size() < MAX_DICTIONARY_SIZE) {
+				index = dictionary.size();
+				auto stored = duckdb::StringVector::AddString(result, utf8.data, utf8.size);
+				dictionary.push_back(stored);
+				by_value[stored] = index;
+			} else {
+				flat_only = true;
+				duckdb::FlatVector::GetData<duckdb::string_t>(result)[row] =
+				    duckdb::StringVector::AddString(result, utf8.data, utf8.size);
+				return true;
+			}
+			Py_INCREF(py_item);
+			by_object[py_item] = index;
+		}
+		duckdb::FlatVector::GetData<duckdb::string_t>(result)[row] = dictionary[index];
+		sel.set_index(row, index);
+		return true;
+	}
+
+	// Turns the column into a dictionary vector if at most half its values are distinct
+	void Finish(duckdb::Vector &result, duckdb::idx_t count) {
+		if (!flat_only && count > 0 && dictionary.size() * 2 <= count) {
+			duckdb::Vector values(duckdb::LogicalType::VARCHAR, dictionary.size());
+			auto values_data = duckdb::FlatVector::GetData<duckdb::string_t>(values);
+			for (duckdb::idx_t i = 0; i < dictionary.size(); i++) {
+				values_data[i] = dictionary[i];
+			}
+			if (null_index >= 0) {
+				duckdb::FlatVector::SetNull(values, null_index, true);
+			}
+			// The strings live in the flat vector's heap, which has to outlive it
+			duckdb::StringVector::AddHeapReference(values, result);
+			result.Slice(values, sel, count);
+		}
+		Clear();
+	}
+};
+
+RowConverter::RowConverter(std::vector<duckdb::LogicalType> types_p, const std::vector<std::string> &column_names,
+                           const std::vector<bool> &stringified)
+    : types(std::move(types_p)) {
+	for (size_t i = 0; i < types.size(); i++) {
+		bool stringify = i < stringified.size() && stringified[i];
+		string_columns.push_back(types[i].id() == duckdb::LogicalTypeId::VARCHAR
+		                             ? duckdb::make_uniq<StringColumn>(stringify)
+		                             : nullptr);
+	}
+	for (auto &name : column_names) {
+		PyObject *py_name = PyUnicode_InternFromString(name.c_str());
+		if (!py_name) {
+			PyErr_Clear();
+			py_name = Py_None;
+			Py_INCREF(py_name);
+		}
+		names.push_back(py_name);
+	}
+}
+
+RowConverter::~RowConverter() {
+	for (auto py_name : names) {
+		Py_DECREF(py_name);
+	}
+	Py_XDECREF(row_type);
+}
+
+duckdb::idx_t RowConverter::Convert(PyObject *py_row, duckdb::DataChunk &output, duckdb::idx_t row) {
+	if (PyTuple_Check(py_row) || PyList_Check(py_row)) {
+		// Includes NamedTuples
+		return ConvertSequence(py_row, output, row);
+	}
+	if (PyDict_Check(py_row)) {
+		// Includes TypedDicts, keys are matched against column names and missing keys are NULL
+		duckdb::idx_t failed = 0;
+		for (size_t i = 0; i < types.size(); i++) {
+			PyObject *py_item = PyDict_GetItem(py_row, names[i]);
+			failed += !ConvertValue(i, py_item ? py_item : Py_None, output, row);
+		}
+		return failed;
+	}
+	if ((PyObject *)Py_TYPE(py_row) != row_type) {
+		ResolveRowType(py_row);
+	}
+	if (row_type_iterable) {
+		return ConvertSequence(py_row, output, row);
+	}
+	return ConvertAttributes(py_row, output, row);
+}
+
+void RowConverter::FinishChunk(duckdb::DataChunk &output) {
+	for (size_t i = 0; i < string_columns.size(); i++) {
+		if (string_columns[i]) {
+			string_columns[i]->Finish(output.data[i], output.size());
+		}
+	}
+}
+
+bool RowConverter::ConvertValue(size_t col, PyObject *py_item, duckdb::DataChunk &output, duckdb::idx_t row) {
+	if (string_columns[col]) {
+		return string_columns[col]->Write(py_item, output.data[col], row);
+	}
+	return ConvertPyObjectToVector(py_item, types[col], output.data[col], row);
+}
+
+duckdb::idx_t RowConverter::ConvertSequence(PyObject *py_row, duckdb::DataChunk &output, duckdb::idx_t row) {
+	// Tuples and lists come back as is, anything else iterable is materialized into a list
+	PyObject *py_seq = PySequence_Fast(py_row, "Row record not iterable as expected");
+	if (!py_seq) {
+		PyErr_Clear();
+		throw std::runtime_error("Error: Row record not iterable as expected");
+	}
+
+	auto size = (size_t)FastSequenceSize(py_seq);
+	if (size != types.size()) {
+		Py_DECREF(py_seq);
+		auto error_message = "A row with " + std::to_string(size) + " values was detected though " +
+		                     std::to_string(types.size()) + " columns were expected";
+		throw duckdb::InvalidInputException(error_message);
+	}
+
+	duckdb::idx_t failed = 0;
+	for (size_t i = 0; i < size; i++) {
+		// Borrowed reference
+		failed += !ConvertValue(i, FastSequenceItem(py_seq, i), output, row);
+	}
+	Py_DECREF(py_seq);
+	return failed;
+}
+
+void RowConverter::ResolveRowType(PyObject *py_row) {
+	Py_XDECREF(row_type);
+	row_type = (PyObject *)Py_TYPE(py_row);
+	Py_INCREF(row_type);
+
+	PyObject *iter = PyObject_GetIter(py_row);
+	row_type_iterable = (iter != nullptr);
+	Py_XDECREF(iter);
+	PyErr_Clear();
+	if (row_type_iterable) {
+		return;
+	}
+
+	// Not iterable, so the columns have to be found as attributes, eg fields of a dataclass
+	bool found = false;
+	slot_offsets.assign(names.size(), -1);
+	for (size_t i = 0; i < names.size(); i++) {
+		if (!PyObject_HasAttr(py_row, names[i])) {
+			continue;
+		}
+		found = true;
+#ifndef Py_LIMITED_API
+		// Attributes backed by __slots__ (eg dataclasses with slots=True) are read straight from
+		// the instance rather than through getattr
+		PyObject *descr = _PyType_Lookup(Py_TYPE(py_row), names[i]);
+		if (descr && Py_TYPE(descr) == &PyMemberDescr_Type) {
+			PyMemberDef *member = ((PyMemberDescrObject *)descr)->d_member;
+			if (member->type == T_OBJECT_EX || member->type == T_OBJECT) {
+				slot_offsets[i] = member->offset;
+			}
+		}
+#endif
+	}
+	if (!found) {
+		throw std::runtime_error("Error: Row record not iterable as expected");
+	}
+}
+
+duckdb::idx_t RowConverter::ConvertAttributes(PyObject *py_row, duckdb::DataChunk &output, duckdb::idx_t row) {
+	duckdb::idx_t failed = 0;
+	for (size_t i = 0; i < types.size(); i++) {
+#ifndef Py_LIMITED_API
+		if (slot_offsets[i] >= 0) {
+			// Borrowed reference, null if the slot was never assigned
+			PyObject *py_item = *(PyObject **)((char *)py_row + slot_offsets[i]);
+			failed += !ConvertValue(i, py_item ? py_item : Py_None, output, row);
+			continue;
+		}
+#endif
+		PyObject *py_item = PyObject_GetAttr(py_row, names[i]);
+		if (!py_item) {
+			PyErr_Clear();
+			ConvertValue(i, Py_None, output, row);
+			continue;
+		}
+		failed += !ConvertValue(i, py_item, output, row);
+		Py_DECREF(py_item);
+	}
+	return failed;
+}
+
 PyObject *duckdb_to_py(duckdb::Value &value) {
 	PyObject *py_value = nullptr;
 
+	if (value.IsNull()) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	auto &types = PyTypes();
 	switch (value.type().id()) {
 	case duckdb::LogicalTypeId::BOOLEAN:
 		py_value = PyBool_FromLong(value.GetValue<bool>());
@@ -27,20 +941,160 @@ PyObject *duckdb_to_py(duckdb::Value &value) {
 	case duckdb::LogicalTypeId::BIGINT:
 		py_value = PyLong_FromLongLong(value.GetValue<int64_t>());
 		break;
+	case duckdb::LogicalTypeId::UTINYINT:
+		py_value = PyLong_FromUnsignedLong(value.GetValue<uint8_t>());
+		break;
+	case duckdb::LogicalTypeId::USMALLINT:
+		py_value = PyLong_FromUnsignedLong(value.GetValue<uint16_t>());
+		break;
+	case duckdb::LogicalTypeId::UINTEGER:
+		py_value = PyLong_FromUnsignedLong(value.GetValue<uint32_t>());
+		break;
+	case duckdb::LogicalTypeId::UBIGINT:
+		py_value = PyLong_FromUnsignedLongLong(value.GetValue<uint64_t>());
+		break;
+	case duckdb::LogicalTypeId::HUGEINT:
+		py_value = HugeintToPyLong(value.GetValue<duckdb::hugeint_t>());
+		break;
 	case duckdb::LogicalTypeId::FLOAT:
 		py_value = PyFloat_FromDouble(value.GetValue<float>());
 		break;
 	case duckdb::LogicalTypeId::DOUBLE:
 		py_value = PyFloat_FromDouble(value.GetValue<double>());
 		break;
-	case duckdb::LogicalTypeId::VARCHAR:
-		py_value = PyUnicode_FromString(value.GetValue<std::string>().c_str());
+	case duckdb::LogicalTypeId::DECIMAL: {
+		duckdb::hugeint_t unscaled;
+		switch (value.type().InternalType()) {
+		case duckdb::PhysicalType::INT16:
+			unscaled = duckdb::hugeint_t(value.GetValueUnsafe<int16_t>());
+			break;
+		case duckdb::PhysicalType::INT32:
+			unscaled = duckdb::hugeint_t(value.GetValueUnsafe<int32_t>());
+			break;
+		case duckdb::PhysicalType::INT64:
+			unscaled = duckdb::hugeint_t(value.GetValueUnsafe<int64_t>());
+			break;
+		default:
+			unscaled = value.GetValueUnsafe<duckdb::hugeint_t>();
+		}
+		PyObject *py_unscaled = HugeintToPyLong(unscaled);
+		PyObject *decimal = PyObject_CallFunctionObjArgs(types.decimal, py_unscaled, nullptr);
+		Py_DECREF(py_unscaled);
+		if (decimal) {
+			py_value = PyObject_CallMethod(decimal, "scaleb", "iO", -(int)duckdb::DecimalType::GetScale(value.type()),
+			                               types.decimal_context);
+			Py_DECREF(decimal);
+		}
+		break;
+	}
+	case duckdb::LogicalTypeId::VARCHAR: {
+		auto &str = duckdb::StringValue::Get(value);
+		py_value = PyUnicode_FromStringAndSize(str.c_str(), str.size());
+		break;
+	}
+	case duckdb::LogicalTypeId::BLOB: {
+		auto &str = duckdb::StringValue::Get(value);
+		py_value = PyBytes_FromStringAndSize(str.c_str(), str.size());
+		break;
+	}
+	case duckdb::LogicalTypeId::UUID:
+		py_value = HugeintToPyUUID(value.GetValueUnsafe<duckdb::hugeint_t>());
+		break;
+	case duckdb::LogicalTypeId::DATE: {
+		auto date = value.GetValue<duckdb::date_t>();
+		if (!duckdb::Date::IsFinite(date)) {
+			break;
+		}
+		int32_t year, month, day;
+		duckdb::Date::Convert(date, year, month, day);
+		py_value = PyObject_CallFunction(types.date, "iii", year, month, day);
+		break;
+	}
+	case duckdb::LogicalTypeId::TIME: {
+		int32_t hour, minute, second, micros;
+		duckdb::Time::Convert(value.GetValue<duckdb::dtime_t>(), hour, minute, second, micros);
+		py_value = PyObject_CallFunction(types.time, "iiii", hour, minute, second, micros);
 		break;
+	}
+	case duckdb::LogicalTypeId::INTERVAL: {
+		auto interval = value.GetValue<duckdb::interval_t>();
+		// timedelta has no notion of months, so we use the same 30 day approximation DuckDB does
+		int32_t days = interval.months * duckdb::Interval::DAYS_PER_MONTH + interval.days;
+		py_value = PyObject_CallFunction(types.timedelta, "iLL", days, (long long)0, (long long)interval.micros);
+		break;
+	}
+	case duckdb::LogicalTypeId::TIMESTAMP:
+	case duckdb::LogicalTypeId::TIMESTAMP_TZ:
+	case duckdb::LogicalTypeId::TIMESTAMP_SEC:
+	case duckdb::LogicalTypeId::TIMESTAMP_MS:
+	case duckdb::LogicalTypeId::TIMESTAMP_NS: {
+		auto type_id = value.type().id();
+		auto raw = value.GetValueUnsafe<int64_t>();
+		duckdb::timestamp_t timestamp;
+		if (type_id == duckdb::LogicalTypeId::TIMESTAMP_SEC) {
+			timestamp = duckdb::Timestamp::FromEpochSeconds(raw);
+		} else if (type_id == duckdb::LogicalTypeId::TIMESTAMP_MS) {
+			timestamp = duckdb::Timestamp::FromEpochMs(raw);
+		} else if (type_id == duckdb::LogicalTypeId::TIMESTAMP_NS) {
+			timestamp = duckdb::Timestamp::FromEpochNanoSeconds(raw);
+		} else {
+			timestamp = duckdb::timestamp_t(raw);
+		}
+		if (!duckdb::Timestamp::IsFinite(timestamp)) {
+			break;
+		}
+		duckdb::date_t date;
+		duckdb::dtime_t time;
+		int32_t year, month, day, hour, minute, second, micros;
+		duckdb::Timestamp::Convert(timestamp, date, time);
+		duckdb::Date::Convert(date, year, month, day);
+		duckdb::Time::Convert(time, hour, minute, second, micros);
+		if (type_id == duckdb::LogicalTypeId::TIMESTAMP_TZ) {
+			py_value = PyObject_CallFunction(types.datetime, "iiiiiiiO", year, month, day, hour, minute, second,
+			                                 micros, types.timezone_utc);
+		} else {
+			py_value = PyObject_CallFunction(types.datetime, "iiiiiii", year, month, day, hour, minute, second,
+			                                 micros);
+		}
+		break;
+	}
+	case duckdb::LogicalTypeId::ENUM:
+		py_value = PyUnicode_FromString(value.ToString().c_str());
+		break;
+	case duckdb::LogicalTypeId::LIST: {
+		auto &children = duckdb::ListValue::GetChildren(value);
+		py_value = PyList_New(children.size());
+		for (duckdb::idx_t i = 0; i < children.size(); i++) {
+			auto child = children[i];
+			// Steals the reference
+			PyList_SetItem(py_value, i, duckdb_to_py(child));
+		}
+		break;
+	}
+	case duckdb::LogicalTypeId::MAP: {
+		// Maps are a list of key/value structs
+		py_value = PyDict_New();
+		for (auto &entry : duckdb::ListValue::GetChildren(value)) {
+			auto &key_value = duckdb::StructValue::GetChildren(entry);
+			auto key = key_value[0];
+			auto val = key_value[1];
+			PyObject *py_key = duckdb_to_py(key);
+			PyObject *py_val = duckdb_to_py(val);
+			PyDict_SetItem(py_value, py_key, py_val);
+			Py_DECREF(py_key);
+			Py_DECREF(py_val);
+		}
+		break;
+	}
 	case duckdb::LogicalTypeId::STRUCT:
 		py_value = StructToDict(value);
 		break;
 	default:
 		debug("Unhandled Logical Type: " + value.type().ToString());
+	}
+
+	if (!py_value) {
+		PyErr_Clear();
 		Py_INCREF(Py_None);
 		py_value = Py_None;
 	}
@@ -59,65 +1113,301 @@ PyObject *duckdbs_to_pys(std::vector<duckdb::Value> &values) {
 	return py_tuple;
 }
 
-duckdb::Value ConvertPyObjectToDuckDBValue(PyObject *py_item, duckdb::LogicalType logical_type) {
-	duckdb::Value value;
-	PyObject *py_value;
-	bool conversion_failed = false;
+// Ints from 0 up to this are shared rather than allocated for every value. CPython only keeps its
+// own for -5 to 256.
+static const int64_t SMALL_INT_LIMIT = 1024;
+// A converter looks values up among those it has converted this chunk until this many lookups have
+// found nothing, as the column's values evidently don't repeat
+static const duckdb::idx_t CACHE_TRIAL = 64;
+// Most values a converter holds on to for a chunk, and short strings across chunks
+static const duckdb::idx_t MAX_CHUNK_VALUES = STANDARD_VECTOR_SIZE;
+static const duckdb::idx_t MAX_SHORT_STRINGS = 4096;
 
-	switch (logical_type.id()) {
+static PyObject *IntToPy(int64_t value) {
+	if (value < 0 || value >= SMALL_INT_LIMIT) {
+		return PyLong_FromLongLong(value);
+	}
+	// Held for the life of the interpreter
+	static PyObject *small_ints[SMALL_INT_LIMIT] = {};
+	auto &small_int = small_ints[value];
+	if (!small_int) {
+		small_int = PyLong_FromLongLong(value);
+	}
+	Py_XINCREF(small_int);
+	return small_int;
+}
+
+VectorConverter::VectorConverter(const duckdb::LogicalType &type_p) : type(type_p) {
+	switch (type.id()) {
 	case duckdb::LogicalTypeId::BOOLEAN:
-		if (!PyBool_Check(py_item)) {
-			conversion_failed = true;
-		} else {
-			value = duckdb::Value(Py_True == py_item);
+	case duckdb::LogicalTypeId::TINYINT:
+	case duckdb::LogicalTypeId::SMALLINT:
+	case duckdb::LogicalTypeId::INTEGER:
+	case duckdb::LogicalTypeId::BIGINT:
+	case duckdb::LogicalTypeId::UTINYINT:
+	case duckdb::LogicalTypeId::USMALLINT:
+	case duckdb::LogicalTypeId::UINTEGER:
+	case duckdb::LogicalTypeId::UBIGINT:
+	case duckdb::LogicalTypeId::FLOAT:
+	case duckdb::LogicalTypeId::DOUBLE:
+	case duckdb::LogicalTypeId::VARCHAR:
+	case duckdb::LogicalTypeId::BLOB:
+		break;
+	case duckdb::LogicalTypeId::LIST:
+		children.push_back(duckdb::make_uniq<VectorConverter>(duckdb::ListType::GetChildType(type)));
+		break;
+	case duckdb::LogicalTypeId::MAP:
+		children.push_back(duckdb::make_uniq<VectorConverter>(duckdb::MapType::KeyType(type)));
+		children.push_back(duckdb::make_uniq<VectorConverter>(duckdb::MapType::ValueType(type)));
+		break;
+	case duckdb::LogicalTypeId::STRUCT:
+		for (auto &child : duckdb::StructType::GetChildTypes(type)) {
+			children.push_back(duckdb::make_uniq<VectorConverter>(child.second));
+			PyObject *py_name = PyUnicode_InternFromString(child.first.c_str());
+			if (!py_name) {
+				PyErr_Clear();
+				py_name = Py_None;
+				Py_INCREF(py_name);
+			}
+			child_names.push_back(py_name);
+		}
+		break;
+	default:
+		// Everything else is converted through duckdb::Value, which is worth avoiding for repeats
+		if (duckdb::TypeIsConstantSize(type.InternalType()) && duckdb::GetTypeIdSize(type.InternalType()) <= 8) {
+			raw_size = duckdb::GetTypeIdSize(type.InternalType());
+		}
+	}
+}
+
+VectorConverter::~VectorConverter() {
+	ClearChunk();
+	for (auto &entry : short_strings) {
+		Py_DECREF(entry.second);
+	}
+	for (auto py_name : child_names) {
+		Py_DECREF(py_name);
+	}
+}
+
+void VectorConverter::ClearChunk() {
+	for (auto &entry : entry_cache) {
+		Py_DECREF(entry.second);
+	}
+	entry_cache.clear();
+	for (auto &entry : chunk_strings) {
+		Py_DECREF(entry.second);
+	}
+	chunk_strings.clear();
+	for (auto &entry : raw_values) {
+		Py_DECREF(entry.second);
+	}
+	raw_values.clear();
+	lookups = hits = 0;
+}
+
+void VectorConverter::SetVector(duckdb::Vector &vector_p, duckdb::idx_t count) {
+	ClearChunk();
+	vector = &vector_p;
+	vector->ToUnifiedFormat(count, format);
+	cache_entries = vector->GetVectorType() != duckdb::VectorType::FLAT_VECTOR && !type.IsNested();
+	switch (type.id()) {
+	case duckdb::LogicalTypeId::LIST:
+		children[0]->SetVector(duckdb::ListVector::GetEntry(*vector), duckdb::ListVector::GetListSize(*vector));
+		break;
+	case duckdb::LogicalTypeId::MAP: {
+		auto size = duckdb::ListVector::GetListSize(*vector);
+		children[0]->SetVector(duckdb::MapVector::GetKeys(*vector), size);
+		children[1]->SetVector(duckdb::MapVector::GetValues(*vector), size);
+		break;
+	}
+	case duckdb::LogicalTypeId::STRUCT: {
+		// The children of a flat or constant struct line up with its entries
+		struct_as_value = vector->GetVectorType() == duckdb::VectorType::DICTIONARY_VECTOR;
+		if (!struct_as_value) {
+			auto &entries = duckdb::StructVector::GetEntries(*vector);
+			for (duckdb::idx_t i = 0; i < children.size(); i++) {
+				children[i]->SetVector(*entries[i], count);
+			}
 		}
 		break;
+	}
+	default:
+		break;
+	}
+}
+
+PyObject *VectorConverter::Convert(duckdb::idx_t row) {
+	auto index = format.sel->get_index(row);
+	if (!format.validity.RowIsValid(index)) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+	if (!cache_entries) {
+		return ConvertEntry(row, index);
+	}
+	auto cached = entry_cache.find(index);
+	if (cached != entry_cache.end()) {
+		Py_INCREF(cached->second);
+		return cached->second;
+	}
+	PyObject *result = ConvertEntry(row, index);
+	Py_INCREF(result);
+	entry_cache[index] = result;
+	return result;
+}
+
+PyObject *VectorConverter::ConvertEntry(duckdb::idx_t row, duckdb::idx_t index) {
+	PyObject *result = nullptr;
+	switch (type.id()) {
+	case duckdb::LogicalTypeId::BOOLEAN:
+		result = PyBool_FromLong(((bool *)format.data)[index]);
+		break;
 	case duckdb::LogicalTypeId::TINYINT:
+		result = IntToPy(((int8_t *)format.data)[index]);
+		break;
 	case duckdb::LogicalTypeId::SMALLINT:
+		result = IntToPy(((int16_t *)format.data)[index]);
+		break;
 	case duckdb::LogicalTypeId::INTEGER:
-		if (!PyLong_Check(py_item)) {
-			conversion_failed = true;
-		} else {
-			value = duckdb::Value((int32_t)PyLong_AsLong(py_item));
-		}
+		result = IntToPy(((int32_t *)format.data)[index]);
+		break;
+	case duckdb::LogicalTypeId::BIGINT:
+		result = IntToPy(((int64_t *)format.data)[index]);
+		break;
+	case duckdb::LogicalTypeId::UTINYINT:
+		result = IntToPy(((uint8_t *)format.data)[index]);
 		break;
-	// case duckdb::LogicalTypeId::BIGINT:
-	//   if (!PyLong_Check(py_item)) {
-	//     conversion_failed = true;
-	//   } else {
-	//     value = duckdb::Value(PyLong_AsLongLong(py_item));
-	//   }
-	//   break;
+	case duckdb::LogicalTypeId::USMALLINT:
+		result = IntToPy(((uint16_t *)format.data)[index]);
+		break;
+	case duckdb::LogicalTypeId::UINTEGER:
+		result = IntToPy(((uint32_t *)format.data)[index]);
+		break;
+	case duckdb::LogicalTypeId::UBIGINT: {
+		auto value = ((uint64_t *)format.data)[index];
+		result = value < (uint64_t)SMALL_INT_LIMIT ? IntToPy(value) : PyLong_FromUnsignedLongLong(value);
+		break;
+	}
 	case duckdb::LogicalTypeId::FLOAT:
+		result = PyFloat_FromDouble(((float *)format.data)[index]);
+		break;
 	case duckdb::LogicalTypeId::DOUBLE:
-		if (!PyFloat_Check(py_item)) {
-			conversion_failed = true;
-		} else {
-			value = duckdb::Value(PyFloat_AsDouble(py_item));
-		}
+		result = PyFloat_FromDouble(((double *)format.data)[index]);
 		break;
 	case duckdb::LogicalTypeId::VARCHAR:
-		if (!PyUnicode_Check(py_item)) {
-			conversion_failed = true;
-		} else {
-			py_value = PyUnicode_AsUTF8String(py_item);
-			value = duckdb::Value(PyBytes_AsString(py_value));
-			Py_DECREF(py_value);
+		result = ConvertString(((duckdb::string_t *)format.data)[index]);
+		break;
+	case duckdb::LogicalTypeId::BLOB: {
+		auto &blob = ((duckdb::string_t *)format.data)[index];
+		result = PyBytes_FromStringAndSize(blob.GetData(), blob.GetSize());
+		break;
+	}
+	case duckdb::LogicalTypeId::LIST: {
+		auto &entry = ((duckdb::list_entry_t *)format.data)[index];
+		result = PyList_New(entry.length);
+		for (duckdb::idx_t i = 0; result && i < entry.length; i++) {
+			// Steals the reference
+			PyList_SetItem(result, i, children[0]->Convert(entry.offset + i));
 		}
 		break;
-		// Add more cases for other LogicalTypes here
+	}
+	case duckdb::LogicalTypeId::MAP: {
+		auto &entry = ((duckdb::list_entry_t *)format.data)[index];
+		result = PyDict_New();
+		for (duckdb::idx_t i = 0; result && i < entry.length; i++) {
+			PyObject *py_key = children[0]->Convert(entry.offset + i);
+			PyObject *py_val = children[1]->Convert(entry.offset + i);
+			if (PyDict_SetItem(result, py_key, py_val) < 0) {
+				// Keys such as lists aren't hashable
+				PyErr_Clear();
+			}
+			Py_DECREF(py_key);
+			Py_DECREF(py_val);
+		}
+		break;
+	}
 	case duckdb::LogicalTypeId::STRUCT:
-		py_value = StructToDict(value);
+		result = ConvertStruct(row, index);
 		break;
 	default:
-		conversion_failed = true;
+		if (raw_size) {
+			result = ConvertRaw(row, index);
+		} else {
+			auto value = vector->GetValue(row);
+			result = duckdb_to_py(value);
+		}
+	}
+	if (!result) {
+		PyErr_Clear();
+		Py_INCREF(Py_None);
+		result = Py_None;
 	}
+	return result;
+}
 
-	if (conversion_failed) {
-		// DUCKDB_API Value(std::nullptr_t val); // NOLINT: Allow implicit conversion from `nullptr_t`
-		value = duckdb::Value((std::nullptr_t)NULL);
+PyObject *VectorConverter::ConvertString(const duckdb::string_t &value) {
+	auto size = value.GetSize();
+	bool is_short = size <= duckdb::string_t::INLINE_LENGTH;
+	auto &cache = is_short ? short_strings : chunk_strings;
+	bool caching = is_short || lookups < CACHE_TRIAL || hits > 0;
+	if (caching) {
+		lookups += !is_short;
+		auto known = cache.find(value);
+		if (known != cache.end()) {
+			hits += !is_short;
+			Py_INCREF(known->second);
+			return known->second;
+		}
 	}
-	return value;
+	PyObject *result = PyUnicode_FromStringAndSize(value.GetData(), size);
+	if (result && caching && cache.size() < (is_short ? MAX_SHORT_STRINGS : MAX_CHUNK_VALUES)) {
+		Py_INCREF(result);
+		cache[value] = result;
+	}
+	return result;
+}
+
+PyObject *VectorConverter::ConvertRaw(duckdb::idx_t row, duckdb::idx_t index) {
+	uint64_t key = 0;
+	memcpy(&key, format.data + index * raw_size, raw_size);
+	bool caching = lookups < CACHE_TRIAL || hits > 0;
+	if (caching) {
+		lookups++;
+		auto known = raw_values.find(key);
+		if (known != raw_values.end()) {
+			hits++;
+			Py_INCREF(known->second);
+			return known->second;
+		}
+	}
+	auto value = vector->GetValue(row);
+	PyObject *result = duckdb_to_py(value);
+	if (caching && raw_values.size() < MAX_CHUNK_VALUES) {
+		Py_INCREF(result);
+		raw_values[key] = result;
+	}
+	return result;
+}
+
+PyObject *VectorConverter::ConvertStruct(duckdb::idx_t row, duckdb::idx_t index) {
+	if (struct_as_value) {
+		auto value = vector->GetValue(row);
+		return duckdb_to_py(value);
+	}
+	PyObject *result = PyDict_New();
+	for (duckdb::idx_t i = 0; result && i < children.size(); i++) {
+		PyObject *py_child = children[i]->Convert(index);
+		PyDict_SetItem(result, child_names[i], py_child);
+		Py_DECREF(py_child);
+	}
+	return result;
+}
+
+duckdb::Value ConvertPyObjectToDuckDBValue(PyObject *py_item, duckdb::LogicalType logical_type) {
+	duckdb::Vector vector(logical_type, 1);
+	ConvertPyObjectToVector(py_item, logical_type, vector, 0);
+	return vector.GetValue(0);
 }
 
 void ConvertPyObjectsToDuckDBValues(PyObject *py_iterator, std::vector<duckdb::LogicalType> logical_types,
@@ -201,6 +1491,8 @@ PyObject *StructToDict(duckdb::Value value) {
 		auto pyName = duckdb_to_py(name);
 		auto pyValue = duckdb_to_py(val);
 		PyDict_SetItem(py_value, pyName, pyValue);
+		Py_DECREF(pyName);
+		Py_DECREF(pyValue);
 	}
 	return py_value;
 }
@@ -208,12 +1500,21 @@ PyObject *StructToDict(duckdb::Value value) {
 std::vector<duckdb::LogicalType> PyTypesToLogicalTypes(const std::vector<PyObject *> &pyTypes) {
 	std::vector<duckdb::LogicalType> logicalTypes;
 
-	// Map Python type names to DuckDB logical types
+	// Map Python type names to DuckDB logical types. Builtins are referenced by their bare
+	// name, everything else is qualified by its module.
 	std::unordered_map<std::string, duckdb::LogicalType> typeMap = {
-	    {"int", duckdb::LogicalType::INTEGER},
+	    {"bool", duckdb::LogicalType::BOOLEAN},
+	    {"int", duckdb::LogicalType::BIGINT},
 	    {"str", duckdb::LogicalType::VARCHAR},
 	    {"float", duckdb::LogicalType::DOUBLE},
-	    // TODO: Add more mappings for other supported Python types
+	    {"bytes", duckdb::LogicalType::BLOB},
+	    {"bytearray", duckdb::LogicalType::BLOB},
+	    {"datetime.date", duckdb::LogicalType::DATE},
+	    {"datetime.datetime", duckdb::LogicalType::TIMESTAMP},
+	    {"datetime.time", duckdb::LogicalType::TIME},
+	    {"datetime.timedelta", duckdb::LogicalType::INTERVAL},
+	    {"decimal.Decimal", duckdb::LogicalType::DECIMAL(18, 3)},
+	    {"uuid.UUID", duckdb::LogicalType::UUID},
 	};
 
 	// Iterate over the Python type objects
@@ -221,54 +1522,43 @@ std::vector<duckdb::LogicalType> PyTypesToLogicalTypes(const std::vector<PyObjec
 		if (PyType_Check(pyType)) {
 			// Get the type name as a C++ string
 			PyObject *typeNameObj = PyObject_GetAttrString(pyType, "__name__");
+			PyObject *moduleNameObj = PyObject_GetAttrString(pyType, "__module__");
 			if (typeNameObj && PyUnicode_Check(typeNameObj)) {
-				const char *typeName = Unicode_AsUTF8(typeNameObj);
+				std::string qualifiedName = Unicode_AsUTF8(typeNameObj);
+				if (moduleNameObj && PyUnicode_Check(moduleNameObj)) {
+					auto moduleName = Unicode_AsUTF8(moduleNameObj);
+					if (moduleName != "builtins") {
+						qualifiedName = moduleName + "." + qualifiedName;
+					}
+				}
 
 				// Find the corresponding DuckDB logical type
-				auto it = typeMap.find(typeName);
+				auto it = typeMap.find(qualifiedName);
 				if (it != typeMap.end()) {
 					logicalTypes.push_back(it->second);
 				} else {
 					// Unknown type, add an invalid logical type
 					logicalTypes.push_back(duckdb::LogicalType::INVALID);
 				}
-
-				// todo: free typeName?
 			}
 
-			// Release the reference to the type name object
+			// Release the reference to the type name objects
 			Py_XDECREF(typeNameObj);
+			Py_XDECREF(moduleNameObj);
+			PyErr_Clear();
 		}
 	}
 
 	return logicalTypes;
 }
 
-// Duplicates functionality of PyUnicode_AsUTF8() which is not part of the limited ABI
-char *Unicode_AsUTF8(PyObject *unicodeObject) {
-	PyObject *utf8 = PyUnicode_AsUTF8String(unicodeObject);
-	if (utf8 == nullptr) {
-		PyErr_Print();
-		return nullptr;
-	}
-
-	char *bytes = PyBytes_AsString(utf8);
-	if (bytes == nullptr) {
-		Py_DECREF(utf8);
-		PyErr_Print();
-		return nullptr;
-	}
-
-	char *result = strdup(bytes);
-	Py_DECREF(utf8);
-
-	if (result == nullptr) {
-		PyErr_SetString(PyExc_MemoryError, "Out of memory");
-		PyErr_Print();
-		return nullptr;
+// Copies the UTF-8 contents of a Python str, or returns an empty string if it can't be encoded
+std::string Unicode_AsUTF8(PyObject *unicodeObject) {
+	UTF8View utf8(unicodeObject);
+	if (!utf8.IsValid()) {
+		return std::string();
 	}
-
-	return result;
+	return std::string(utf8.data, utf8.size);
 }
 
 } // namespace pyudf
@@ -0,0 +1,357 @@
+#include <pyinfer.hpp>
+#include <pyconvert.hpp>
+#include <pycompat.hpp>
+#include <duckdb.hpp>
+#include <duckdb/common/types/decimal.hpp>
+#include <Python.h>
+#include <algorithm>
+#include <limits>
+#include <string>
+
+namespace pyudf {
+
+using duckdb::LogicalType;
+using duckdb::LogicalTypeId;
+
+// Integral types ordered from narrowest to widest
+static int IntegralRank(LogicalTypeId id) {
+	switch (id) {
+	case LogicalTypeId::BOOLEAN:
+		return 0;
+	case LogicalTypeId::INTEGER:
+		return 1;
+	case LogicalTypeId::BIGINT:
+		return 2;
+	case LogicalTypeId::HUGEINT:
+		return 3;
+	default:
+		return -1;
+	}
+}
+
+// Number of integral digits needed to hold an integral type as a DECIMAL
+static uint8_t IntegralDigits(LogicalTypeId id) {
+	switch (id) {
+	case LogicalTypeId::BOOLEAN:
+		return 1;
+	case LogicalTypeId::INTEGER:
+		return 10;
+	case LogicalTypeId::BIGINT:
+		return 19;
+	default:
+		return 39;
+	}
+}
+
+static LogicalType MakeDecimal(int integral_digits, int scale) {
+	int width = std::max(integral_digits + scale, 1);
+	if (width > duckdb::Decimal::MAX_WIDTH_DECIMAL) {
+		return LogicalType::DOUBLE;
+	}
+	return LogicalType::DECIMAL(width, scale);
+}
+
+static LogicalType InferDecimalType(PyObject *py_item) {
+	PyObject *py_tuple = PyObject_CallMethod(py_item, "as_tuple", nullptr);
+	if (!py_tuple) {
+		PyErr_Clear();
+		return LogicalType::VARCHAR;
+	}
+	// (sign, digits, exponent), where exponent is a string for NaN and Infinity
+	PyObject *py_digits = TupleItem(py_tuple, 1);
+	PyObject *py_exponent = TupleItem(py_tuple, 2);
+	if (!PyLong_Check(py_exponent)) {
+		Py_DECREF(py_tuple);
+		return LogicalType::DOUBLE;
+	}
+	long num_digits = (long)PyTuple_Size(py_digits);
+	long exponent = PyLong_AsLong(py_exponent);
+	Py_DECREF(py_tuple);
+
+	long scale = exponent < 0 ? -exponent : 0;
+	long integral_digits = std::max(num_digits + exponent, 0L);
+	if (scale > duckdb::Decimal::MAX_WIDTH_DECIMAL || integral_digits > duckdb::Decimal::MAX_WIDTH_DECIMAL) {
+		return LogicalType::DOUBLE;
+	}
+	return MakeDecimal(integral_digits, scale);
+}
+
+LogicalType InferPyObjectType(PyObject *py_item) {
+	auto &types = PyTypes();
+	if (py_item == Py_None) {
+		return LogicalType::SQLNULL;
+	} else if (PyBool_Check(py_item)) {
+		return LogicalType::BOOLEAN;
+	} else if (PyLong_Check(py_item)) {
+		int overflow;
+		long long value = PyLong_AsLongLongAndOverflow(py_item, &overflow);
+		if (overflow) {
+			return LogicalType::HUGEINT;
+		} else if (value < std::numeric_limits<int32_t>::min() || value > std::numeric_limits<int32_t>::max()) {
+			return LogicalType::BIGINT;
+		}
+		return LogicalType::INTEGER;
+	} else if (PyFloat_Check(py_item)) {
+		return LogicalType::DOUBLE;
+	} else if (PyUnicode_Check(py_item)) {
+		return LogicalType::VARCHAR;
+	} else if (PyBytes_Check(py_item) || PyByteArray_Check(py_item)) {
+		return LogicalType::BLOB;
+	} else if (IsInstance(py_item, types.datetime)) {
+		// Check for datetime before date since it's a subclass
+		PyObject *tzinfo = PyObject_GetAttrString(py_item, "tzinfo");
+		bool has_timezone = tzinfo && tzinfo != Py_None;
+		Py_XDECREF(tzinfo);
+		PyErr_Clear();
+		return has_timezone ? LogicalType::TIMESTAMP_TZ : LogicalType::TIMESTAMP;
+	} else if (IsInstance(py_item, types.date)) {
+		return LogicalType::DATE;
+	} else if (IsInstance(py_item, types.time)) {
+		return LogicalType::TIME;
+	} else if (IsInstance(py_item, types.timedelta)) {
+		return LogicalType::INTERVAL;
+	} else if (IsInstance(py_item, types.decimal)) {
+		return InferDecimalType(py_item);
+	} else if (IsInstance(py_item, types.uuid)) {
+		return LogicalType::UUID;
+	} else if (PyList_Check(py_item) || PyTuple_Check(py_item)) {
+		LogicalType child_type = LogicalType::SQLNULL;
+		auto size = FastSequenceSize(py_item);
+		for (Py_ssize_t i = 0; i < size; i++) {
+			child_type = PromoteLogicalType(child_type, InferPyObjectType(FastSequenceItem(py_item, i)));
+		}
+		return LogicalType::LIST(child_type);
+	} else if (PyDict_Check(py_item)) {
+		if (PyDict_Size(py_item) == 0) {
+			return LogicalType::SQLNULL;
+		}
+		// Dicts keyed by strings are structs, anything else is a map
+		bool string_keys = true;
+		LogicalType key_type = LogicalType::SQLNULL;
+		LogicalType value_type = LogicalType::SQLNULL;
+		duckdb::child_list_t<LogicalType> children;
+		Py_ssize_t pos = 0;
+		PyObject *py_key, *py_value;
+		while (PyDict_Next(py_item, &pos, &py_key, &py_value)) {
+			auto child_type = InferPyObjectType(py_value);
+			string_keys = string_keys && PyUnicode_Check(py_key);
+			if (string_keys) {
+				children.push_back(std::make_pair(Unicode_AsUTF8(py_key), child_type));
+			}
+			key_type = PromoteLogicalType(key_type, InferPyObjectType(py_key));
+			value_type = PromoteLogicalType(value_type, child_type);
+		}
+		if (string_keys) {
+			return LogicalType::STRUCT(children);
+		}
+		return LogicalType::MAP(key_type, value_type);
+	}
+	return LogicalType::VARCHAR;
+}
+
+static LogicalType PromoteStruct(const LogicalType &left, const LogicalType &right) {
+	// Fields are unioned by name, keeping the order they were first seen in
+	auto children = duckdb::StructType::GetChildTypes(left);
+	for (auto &right_child : duckdb::StructType::GetChildTypes(right)) {
+		auto match = std::find_if(children.begin(), children.end(), [&](const std::pair<std::string, LogicalType> &c) {
+			return c.first == right_child.first;
+		});
+		if (match == children.end()) {
+			children.push_back(right_child);
+		} else {
+			match->second = PromoteLogicalType(match->second, right_child.second);
+		}
+	}
+	return LogicalType::STRUCT(children);
+}
+
+LogicalType PromoteLogicalType(const LogicalType &left, const LogicalType &right) {
+	auto left_id = left.id();
+	auto right_id = right.id();
+	if (left_id == LogicalTypeId::SQLNULL) {
+		return right;
+	} else if (right_id == LogicalTypeId::SQLNULL || left == right) {
+		return left;
+	}
+
+	auto left_rank = IntegralRank(left_id);
+	auto right_rank = IntegralRank(right_id);
+	bool left_numeric = left_rank >= 0 || left_id == LogicalTypeId::DOUBLE || left_id == LogicalTypeId::DECIMAL;
+	bool right_numeric = right_rank >= 0 || right_id == LogicalTypeId::DOUBLE || right_id == LogicalTypeId::DECIMAL;
+	if (left_rank >= 0 && right_rank >= 0) {
+		return left_rank > right_rank ? left : right;
+	} else if (left_numeric && right_numeric) {
+		if (left_id == LogicalTypeId::DOUBLE || right_id == LogicalTypeId::DOUBLE) {
+			return LogicalType::DOUBLE;
+		}
+		// At least one side is a DECIMAL, treat the other (if integral) as DECIMAL(digits, 0)
+		int left_scale = left_id == LogicalTypeId::DECIMAL ? duckdb::DecimalType::GetScale(left) : 0;
+		int right_scale = right_id == LogicalTypeId::DECIMAL ? duckdb::DecimalType::GetScale(right) : 0;
+		int left_integral = left_id == LogicalTypeId::DECIMAL ? duckdb::DecimalType::GetWidth(left) - left_scale
+		                                                      : IntegralDigits(left_id);
+		int right_integral = right_id == LogicalTypeId::DECIMAL ? duckdb::DecimalType::GetWidth(right) - right_scale
+		                                                        : IntegralDigits(right_id);
+		return MakeDecimal(std::max(left_integral, right_integral), std::max(left_scale, right_scale));
+	}
+
+	if ((left_id == LogicalTypeId::DATE && right_id == LogicalTypeId::TIMESTAMP) ||
+	    (left_id == LogicalTypeId::TIMESTAMP && right_id == LogicalTypeId::DATE)) {
+		return LogicalType::TIMESTAMP;
+	} else if ((left_id == LogicalTypeId::TIMESTAMP_TZ &&
+	            (right_id == LogicalTypeId::DATE || right_id == LogicalTypeId::TIMESTAMP)) ||
+	           (right_id == LogicalTypeId::TIMESTAMP_TZ &&
+	            (left_id == LogicalTypeId::DATE || left_id == LogicalTypeId::TIMESTAMP))) {
+		return LogicalType::TIMESTAMP_TZ;
+	}
+
+	if (left_id == LogicalTypeId::LIST && right_id == LogicalTypeId::LIST) {
+		return LogicalType::LIST(
+		    PromoteLogicalType(duckdb::ListType::GetChildType(left), duckdb::ListType::GetChildType(right)));
+	} else if (left_id == LogicalTypeId::STRUCT && right_id == LogicalTypeId::STRUCT) {
+		return PromoteStruct(left, right);
+	} else if (left_id == LogicalTypeId::MAP && right_id == LogicalTypeId::MAP) {
+		return LogicalType::MAP(PromoteLogicalType(duckdb::MapType::KeyType(left), duckdb::MapType::KeyType(right)),
+		                        PromoteLogicalType(duckdb::MapType::ValueType(left), duckdb::MapType::ValueType(right)));
+	}
+	return LogicalType::VARCHAR;
+}
+
+// Types we never saw a non-None value for default to VARCHAR
+static LogicalType ResolveNullTypes(const LogicalType &type) {
+	switch (type.id()) {
+	case LogicalTypeId::SQLNULL:
+		return LogicalType::VARCHAR;
+	case LogicalTypeId::LIST:
+		return LogicalType::LIST(ResolveNullTypes(duckdb::ListType::GetChildType(type)));
+	case LogicalTypeId::MAP:
+		return LogicalType::MAP(ResolveNullTypes(duckdb::MapType::KeyType(type)),
+		                        ResolveNullTypes(duckdb::MapType::ValueType(type)));
+	case LogicalTypeId::STRUCT: {
+		auto children = duckdb::StructType::GetChildTypes(type);
+		for (auto &child : children) {
+			child.second = ResolveNullTypes(child.second);
+		}
+		return LogicalType::STRUCT(children);
+	}
+	default:
+		return type;
+	}
+}
+
+// Appends the names of a NamedTuple's or dataclass's fields, returning false for other rows
+static bool AppendFieldNames(PyObject *row, std::vector<std::string> &names) {
+	PyObject *fields = PyObject_GetAttrString(row, PyTuple_Check(row) ? "_fields" : "__dataclass_fields__");
+	if (!fields) {
+		PyErr_Clear();
+		return false;
+	}
+	PyObject *iter = PyObject_GetIter(fields);
+	Py_DECREF(fields);
+	if (!iter) {
+		PyErr_Clear();
+		return false;
+	}
+	PyObject *field;
+	while ((field = PyIter_Next(iter))) {
+		if (PyUnicode_Check(field)) {
+			names.push_back(Unicode_AsUTF8(field));
+		}
+		Py_DECREF(field);
+	}
+	Py_DECREF(iter);
+	PyErr_Clear();
+	return true;
+}
+
+// Widens the column's type to hold 'py_value', noting whether the column held anything but str and None
+static void AddSampleValue(LogicalType &column_type, char &non_string, PyObject *py_value) {
+	column_type = PromoteLogicalType(column_type, InferPyObjectType(py_value));
+	non_string = non_string || (py_value != Py_None && !PyUnicode_Check(py_value));
+}
+
+std::vector<LogicalType> InferColumnTypes(const std::vector<PyObject *> &rows, std::vector<std::string> &names,
+                                          std::vector<bool> &stringified) {
+	std::vector<LogicalType> column_types;
+	// Not a std::vector<bool>, as elements are passed by reference
+	std::vector<char> non_string;
+	if (rows.empty()) {
+		return column_types;
+	}
+
+	if (PyDict_Check(rows[0])) {
+		// Columns are the union of the keys of every sampled dict, in the order first seen
+		for (auto row : rows) {
+			if (!PyDict_Check(row)) {
+				throw duckdb::InvalidInputException("Rows must all be dicts when the first row is a dict");
+			}
+			Py_ssize_t pos = 0;
+			PyObject *py_key, *py_value;
+			while (PyDict_Next(row, &pos, &py_key, &py_value)) {
+				if (!PyUnicode_Check(py_key)) {
+					throw duckdb::InvalidInputException("Dict rows must have str keys to be used as column names");
+				}
+				auto name = Unicode_AsUTF8(py_key);
+				auto it = std::find(names.begin(), names.end(), name);
+				auto col = (size_t)(it - names.begin());
+				if (it == names.end()) {
+					names.push_back(name);
+					column_types.push_back(LogicalType::SQLNULL);
+					non_string.push_back(false);
+				}
+				AddSampleValue(column_types[col], non_string[col], py_value);
+			}
+		}
+	} else if (!PyTuple_Check(rows[0]) && AppendFieldNames(rows[0], names)) {
+		// Dataclasses, whose fields are read as attributes
+		column_types.resize(names.size(), LogicalType::SQLNULL);
+		non_string.resize(names.size(), false);
+		for (auto row : rows) {
+			for (size_t col = 0; col < names.size(); col++) {
+				PyObject *py_item = PyObject_GetAttrString(row, names[col].c_str());
+				if (!py_item) {
+					PyErr_Clear();
+					continue;
+				}
+				AddSampleValue(column_types[col], non_string[col], py_item);
+				Py_DECREF(py_item);
+			}
+		}
+	} else {
+		// Tuples, lists, and other iterables, matched by position. NamedTuples name their columns.
+		if (PyTuple_Check(rows[0])) {
+			AppendFieldNames(rows[0], names);
+		}
+		for (duckdb::idx_t row_idx = 0; row_idx < rows.size(); row_idx++) {
+			PyObject *py_seq = PySequence_Fast(rows[row_idx], "Row record not iterable as expected");
+			if (!py_seq) {
+				PyErr_Clear();
+				throw std::runtime_error("Error: Row record not iterable as expected");
+			}
+			auto size = (size_t)FastSequenceSize(py_seq);
+			if (row_idx == 0) {
+				column_types.resize(size, LogicalType::SQLNULL);
+				non_string.resize(size, false);
+			} else if (size != column_types.size()) {
+				Py_DECREF(py_seq);
+				auto error_message = "A row with " + std::to_string(size) + " values was detected though " +
+				                     std::to_string(column_types.size()) + " columns were expected";
+				throw duckdb::InvalidInputException(error_message);
+			}
+			for (size_t col = 0; col < size; col++) {
+				AddSampleValue(column_types[col], non_string[col], FastSequenceItem(py_seq, col));
+			}
+			Py_DECREF(py_seq);
+		}
+		if (names.size() != column_types.size()) {
+			names.clear();
+		}
+	}
+	stringified.clear();
+	for (size_t col = 0; col < column_types.size(); col++) {
+		column_types[col] = ResolveNullTypes(column_types[col]);
+		stringified.push_back(non_string[col] && column_types[col].id() == LogicalTypeId::VARCHAR);
+	}
+	return column_types;
+}
+
+} // namespace pyudf
@@ -1,54 +1,355 @@
 #include "duckdb.hpp"
 #include "duckdb/common/string_util.hpp"
 #include "duckdb/function/scalar_function.hpp"
+#include "duckdb/execution/expression_executor.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include "duckdb/planner/expression/bound_function_expression.hpp"
 #include <duckdb/parser/parsed_data/create_scalar_function_info.hpp>
 #include <Python.h>
+#include <map>
+#include <mutex>
 #include <string>
 #include <iostream>
 #include "python_function.hpp"
 #include "pyconvert.hpp"
+#include "pycompat.hpp"
+#include "function_registry.hpp"
+#include "interpreter.hpp"
+#include "function_stats.hpp"
+#include "trace.hpp"
+#include "interrupt.hpp"
 
 using namespace duckdb;
 namespace pyudf {
 
+// Counters for the function currently being called, flushed to the shared stats when the
+// function changes or the chunk is done so the atomics aren't touched for every row
+struct ScalarCallStats {
+	std::shared_ptr<FunctionStats> stats;
+	std::string function_specifier;
+	uint64_t start_ns = 0;
+	uint64_t calls = 0;
+	uint64_t rows = 0;
+	uint64_t python_ns = 0;
+	uint64_t conversion_ns = 0;
+	uint64_t null_conversions = 0;
+
+	void Flush() {
+		if (!stats) {
+			return;
+		}
+		AddStat(stats->calls, calls);
+		AddStat(stats->rows, rows);
+		AddStat(stats->chunks, 1);
+		AddStat(stats->python_ns, python_ns);
+		AddStat(stats->conversion_ns, conversion_ns);
+		AddStat(stats->null_conversions, null_conversions);
+		auto &tracer = Tracer::Get();
+		if (tracer.Enabled()) {
+			tracer.Record("pycall", function_specifier, start_ns, NowNanos(),
+			              {{"rows", rows},
+			               {"python_ns", python_ns},
+			               {"conversion_ns", conversion_ns},
+			               {"null_conversions", null_conversions}});
+		}
+		calls = rows = python_ns = conversion_ns = null_conversions = 0;
+	}
+};
+
+// The Python function, resolved once per query when its specifier is known while binding
+struct PyScalarBindData : public FunctionData {
+	std::string function_specifier;
+	std::shared_ptr<PythonFunction> func;
+
+	unique_ptr<FunctionData> Copy() const override {
+		auto copy = make_uniq<PyScalarBindData>();
+		copy->function_specifier = function_specifier;
+		copy->func = func;
+		return std::move(copy);
+	}
+	bool Equals(const FunctionData &other_p) const override {
+		auto &other = (const PyScalarBindData &)other_p;
+		return function_specifier == other.function_specifier;
+	}
+
+	~PyScalarBindData() override {
+		GILGuard gil;
+		func.reset();
+	}
+};
+
+// Converts a chunk's arguments column by column, and holds them for each call
+struct ArgumentConverters {
+	std::vector<unique_ptr<VectorConverter>> columns;
+	unique_ptr<CallArguments> arguments;
+
+	// Call once per chunk. Arguments start at column 'first_arg', after pycall's function specifier.
+	void SetChunk(DataChunk &args, idx_t first_arg) {
+		if (!arguments) {
+			for (idx_t i = first_arg; i < args.ColumnCount(); i++) {
+				columns.push_back(make_uniq<VectorConverter>(args.data[i].GetType()));
+			}
+			arguments = make_uniq<CallArguments>(columns.size());
+		}
+		for (idx_t i = 0; i < columns.size(); i++) {
+			columns[i]->SetVector(args.data[first_arg + i], args.size());
+		}
+	}
+};
+
+// Each thread's argument converters, whose caches carry over between chunks, and instance of a
+// class based function. Torn down along with the thread's expression executor.
+struct PyScalarLocalState : public FunctionLocalState {
+	unique_ptr<PythonUDFInstance> instance;
+	ArgumentConverters converters;
+
+	~PyScalarLocalState() override {
+		GILGuard gil;
+		instance.reset();
+		converters.arguments.reset();
+		converters.columns.clear();
+	}
+};
+
+static unique_ptr<FunctionLocalState> PyScalarInitLocalState(ExpressionState &state,
+                                                             const BoundFunctionExpression &expr,
+                                                             FunctionData *bind_data_p) {
+	auto local_state = make_uniq<PyScalarLocalState>();
+	auto bind_data = (PyScalarBindData *)bind_data_p;
+	if (bind_data && bind_data->func->udf_class()) {
+		GILGuard gil;
+		local_state->instance = make_uniq<PythonUDFInstance>(*bind_data->func);
+	}
+	return std::move(local_state);
+}
+
+static PythonUDFInstance *GetUDFInstance(ExpressionState &state) {
+	auto local_state = (PyScalarLocalState *)ExecuteFunctionState::GetFunctionState(state);
+	return local_state ? local_state->instance.get() : nullptr;
+}
+
+static ArgumentConverters &GetConverters(ExpressionState &state, DataChunk &args, idx_t first_arg) {
+	auto &local_state = (PyScalarLocalState &)*ExecuteFunctionState::GetFunctionState(state);
+	local_state.converters.SetChunk(args, first_arg);
+	return local_state.converters;
+}
+
+static void ThrowCallError(PythonException *error, const std::string &funcspec, ScalarCallStats &call_stats,
+                           PythonCallWatch &watch) {
+	AddStat(call_stats.stats->exceptions, 1);
+	call_stats.Flush();
+	std::string err = error->message;
+	error->~PythonException();
+	watch.ThrowIfInterrupted(funcspec);
+	throw std::runtime_error(err);
+}
+
+// Calls the function on one row of the chunk the converters are set to, and writes the result.
+// 'func' is either a PythonFunction or a PythonUDFInstance.
+template <class CALLABLE>
+static void CallForRow(const CALLABLE &func, const std::string &funcspec, ArgumentConverters &converters,
+                       idx_t row, Vector &result, ScalarCallStats &call_stats, PythonCallWatch &watch) {
+	auto convert_start = NowNanos();
+	auto &pyargs = *converters.arguments;
+	for (idx_t i = 0; i < converters.columns.size(); i++) {
+		// Convert the arguments for this row
+		pyargs.Set(i, converters.columns[i]->Convert(row));
+	}
+
+	auto call_start = NowNanos();
+	PyObject *pyresult;
+	PythonException *error;
+	watch.BeginCall();
+	std::tie(pyresult, error) = func.call(pyargs);
+	watch.EndCall();
+	auto call_end = NowNanos();
+	call_stats.calls++;
+	call_stats.rows++;
+	call_stats.python_ns += call_end - call_start;
+	call_stats.conversion_ns += call_start - convert_start;
+	pyargs.Clear();
+	if (!pyresult) {
+		ThrowCallError(error, funcspec, call_stats, watch);
+	}
+	call_stats.null_conversions += !ConvertPyObjectToVector(pyresult, result.GetType(), result, row);
+	Py_DECREF(pyresult);
+	call_stats.conversion_ns += NowNanos() - call_end;
+}
+
+// Hands the whole chunk to the instance's process_batch(), one list per argument, which must return
+// a sequence with a result for every row
+static void CallForBatch(const PythonUDFInstance &instance, const std::string &funcspec,
+                         ArgumentConverters &converters, idx_t count, Vector &result, ScalarCallStats &call_stats,
+                         PythonCallWatch &watch) {
+	auto convert_start = NowNanos();
+	std::vector<PyObject *> columns;
+	for (auto &converter : converters.columns) {
+		PyObject *column = PyList_New(count);
+		for (idx_t row = 0; row < count; row++) {
+			PyList_SetItem(column, row, converter->Convert(row));
+		}
+		columns.push_back(column);
+	}
+
+	auto call_start = NowNanos();
+	PyObject *pyresults;
+	PythonException *error;
+	watch.BeginCall();
+	std::tie(pyresults, error) = instance.call_batch(columns.data(), columns.size());
+	watch.EndCall();
+	auto call_end = NowNanos();
+	call_stats.calls++;
+	call_stats.rows += count;
+	call_stats.python_ns += call_end - call_start;
+	call_stats.conversion_ns += call_start - convert_start;
+	for (auto column : columns) {
+		Py_DECREF(column);
+	}
+	if (!pyresults) {
+		ThrowCallError(error, funcspec, call_stats, watch);
+	}
+	if (!PySequence_Check(pyresults) || PySequence_Size(pyresults) != (Py_ssize_t)count) {
+		PyErr_Clear();
+		Py_DECREF(pyresults);
+		AddStat(call_stats.stats->exceptions, 1);
+		call_stats.Flush();
+		throw std::runtime_error("process_batch() of '" + funcspec + "' must return a sequence of " +
+		                         std::to_string(count) + " results");
+	}
+	for (idx_t row = 0; row < count; row++) {
+		PyObject *pyresult = PySequence_GetItem(pyresults, row);
+		call_stats.null_conversions += !ConvertPyObjectToVector(pyresult, result.GetType(), result, row);
+		Py_DECREF(pyresult);
+	}
+	Py_DECREF(pyresults);
+	call_stats.conversion_ns += NowNanos() - call_end;
+}
+
+// Runs a chunk through a class based function's instance, returning false if there is none
+static bool CallInstance(ExpressionState &state, const std::string &funcspec, DataChunk &args, idx_t first_arg,
+                         Vector &result, uint64_t gil_start, uint64_t gil_acquired, PythonCallWatch &watch) {
+	auto instance = GetUDFInstance(state);
+	if (!instance) {
+		return false;
+	}
+	ScalarCallStats call_stats;
+	call_stats.stats = StatsRegistry::Get().For(funcspec);
+	call_stats.function_specifier = funcspec;
+	call_stats.start_ns = gil_acquired;
+	AddStat(call_stats.stats->gil_wait_ns, gil_acquired - gil_start);
+	Tracer::Get().Record("GIL", funcspec, gil_start, gil_acquired);
+	auto convert_start = NowNanos();
+	auto &converters = GetConverters(state, args, first_arg);
+	call_stats.conversion_ns += NowNanos() - convert_start;
+	if (instance->batched()) {
+		CallForBatch(*instance, funcspec, converters, args.size(), result, call_stats, watch);
+	} else {
+		for (idx_t row = 0; row < args.size(); row++) {
+			CallForRow(*instance, funcspec, converters, row, result, call_stats, watch);
+		}
+	}
+	call_stats.Flush();
+	return true;
+}
+
+// Runs a chunk through the plain function resolved while binding, with its arguments starting at
+// column 'first_arg'
+static void CallBoundFunction(ExpressionState &state, const PyScalarBindData &bind_data, DataChunk &args,
+                              idx_t first_arg, Vector &result, uint64_t gil_start, uint64_t gil_acquired,
+                              PythonCallWatch &watch) {
+	ScalarCallStats call_stats;
+	call_stats.stats = StatsRegistry::Get().For(bind_data.function_specifier);
+	call_stats.function_specifier = bind_data.function_specifier;
+	call_stats.start_ns = gil_acquired;
+	AddStat(call_stats.stats->gil_wait_ns, gil_acquired - gil_start);
+	Tracer::Get().Record("GIL", bind_data.function_specifier, gil_start, gil_acquired);
+	auto convert_start = NowNanos();
+	auto &converters = GetConverters(state, args, first_arg);
+	call_stats.conversion_ns += NowNanos() - convert_start;
+	for (idx_t row = 0; row < args.size(); row++) {
+		CallForRow(*bind_data.func, bind_data.function_specifier, converters, row, result, call_stats, watch);
+	}
+	call_stats.Flush();
+}
+
 static void PyScalarFunction(DataChunk &args, ExpressionState &state, Vector &result) {
+	auto gil_start = NowNanos();
+	GILGuard gil;
+	auto gil_acquired = NowNanos();
+	auto gil_wait = gil_acquired - gil_start;
+	auto &context = state.GetContext();
+	PythonCallWatch watch(context, PythonTimeoutMillis(context));
+
+	auto &func_expr = (BoundFunctionExpression &)state.expr;
+	if (func_expr.bind_info) {
+		// The specifier is a constant, its function was resolved while binding
+		auto &bind_data = (PyScalarBindData &)*func_expr.bind_info;
+		if (!CallInstance(state, bind_data.function_specifier, args, 1, result, gil_start, gil_acquired, watch)) {
+			CallBoundFunction(state, bind_data, args, 1, result, gil_start, gil_acquired, watch);
+		}
+		return;
+	}
+
+	std::string funcspec;
+	std::shared_ptr<PythonFunction> func;
+	ScalarCallStats call_stats;
+	auto convert_start = NowNanos();
+	auto &converters = GetConverters(state, args, 1);
+	auto setup_ns = NowNanos() - convert_start;
 	for (idx_t row = 0; row < args.size(); row++) {
 		// Grab the FunctionSpecifier argument. In practice this is almost always going
 		// to be constants, but in theory they could be column values.
 		auto &funcspec_column = args.data[0];
 		auto funcspec_value = funcspec_column.GetValue(row).GetValue<std::string>();
-		auto func = PythonFunction(funcspec_value);
-
-		std::vector<duckdb::Value> duck_args;
-
-		for (idx_t i = 1; i < args.ColumnCount(); i++) {
-			// Fill the tuple with the arguments for this row
-			auto &column = args.data[i];
-			auto value = column.GetValue(row);
-			duck_args.emplace_back(value);
+		if (!func || funcspec_value != funcspec) {
+			func = FunctionRegistry::Get().GetFunction(funcspec_value);
+			funcspec = funcspec_value;
+			if (func->udf_class()) {
+				throw InvalidInputException("'" + funcspec +
+				                            "' is a class based function, which needs a constant function specifier");
+			}
+			call_stats.Flush();
+			call_stats.stats = StatsRegistry::Get().For(funcspec);
+			call_stats.function_specifier = funcspec;
+			call_stats.start_ns = NowNanos();
+			call_stats.conversion_ns += setup_ns;
+			setup_ns = 0;
+			if (gil_wait) {
+				AddStat(call_stats.stats->gil_wait_ns, gil_wait);
+				Tracer::Get().Record("GIL", funcspec, gil_start, gil_acquired);
+				gil_wait = 0;
+			}
 		}
-		auto pyargs = duckdbs_to_pys(duck_args);
+		CallForRow(*func, funcspec, converters, row, result, call_stats, watch);
+	}
+	call_stats.Flush();
+}
 
-		PyObject *pyresult;
-		PythonException *error;
-		std::tie(pyresult, error) = func.call(pyargs);
-		if (!pyresult) {
-			Py_XDECREF(pyresult);
-			Py_XDECREF(pyargs);
-			std::string err = error->message;
-			error->~PythonException();
-			throw std::runtime_error(err);
-		} else {
-			auto ddb_result = ConvertPyObjectToDuckDBValue(pyresult, duckdb::LogicalTypeId::VARCHAR);
-			result.SetValue(row, ddb_result);
-			Py_XDECREF(pyargs);
-			Py_XDECREF(pyresult);
-		}
+// Functions declared with @ducktables.volatile are bound with side effects, so they run for every
+// row. Everything else is folded while planning when its arguments are constant, and identical
+// calls in a query are evaluated once.
+static unique_ptr<FunctionData> PyScalarBind(ClientContext &context, ScalarFunction &bound_function,
+                                             vector<unique_ptr<Expression>> &arguments) {
+	if (arguments.empty() || !arguments[0]->IsFoldable()) {
+		return nullptr;
+	}
+	auto funcspec_value = ExpressionExecutor::EvaluateScalar(context, *arguments[0]);
+	if (funcspec_value.IsNull()) {
+		return nullptr;
 	}
+	auto bind_data = make_uniq<PyScalarBindData>();
+	bind_data->function_specifier = funcspec_value.ToString();
+	GILGuard gil;
+	bind_data->func = FunctionRegistry::Get().GetFunction(bind_data->function_specifier);
+	if (bind_data->func->declared_volatile()) {
+		bound_function.side_effects = FunctionSideEffects::HAS_SIDE_EFFECTS;
+	}
+	return std::move(bind_data);
 }
 
 CreateScalarFunctionInfo GetPythonScalarFunction() {
-	auto scalar_func = ScalarFunction("pycall", {LogicalType::VARCHAR}, LogicalType::VARCHAR, PyScalarFunction);
+	auto scalar_func = ScalarFunction("pycall", {LogicalType::VARCHAR}, LogicalType::VARCHAR, PyScalarFunction,
+	                                  PyScalarBind, nullptr, nullptr, PyScalarInitLocalState);
 	scalar_func.varargs = LogicalType::ANY;
 
 	// 'named_parameters' does not appear to be supported for scalar functions
@@ -56,4 +357,135 @@ CreateScalarFunctionInfo GetPythonScalarFunction() {
 	CreateScalarFunctionInfo py_scalar_function_info(scalar_func);
 	return CreateScalarFunctionInfo(py_scalar_function_info);
 }
+
+// The 'module:function' behind each function created by pytables_register(). Each database has its own
+// catalog, so these are kept in its object cache and go away along with it. Bind callbacks are plain
+// function pointers, so this is how they find out which Python function they are binding.
+struct RegisteredFunctions : public ObjectCacheEntry {
+	std::map<std::string, std::string> specifiers;
+
+	static std::string ObjectType() {
+		return "pytables_registered_functions";
+	}
+	std::string GetObjectType() override {
+		return ObjectType();
+	}
+};
+
+static std::mutex registered_lock;
+
+// Call with registered_lock held
+static RegisteredFunctions &GetRegisteredFunctions(ClientContext &context) {
+	auto &cache = ObjectCache::GetObjectCache(context);
+	auto registered = cache.Get<RegisteredFunctions>(RegisteredFunctions::ObjectType());
+	if (!registered) {
+		registered = std::make_shared<RegisteredFunctions>();
+		cache.Put(RegisteredFunctions::ObjectType(), registered);
+	}
+	return *registered;
+}
+
+static std::string RegisteredSpecifier(ClientContext &context, const std::string &name) {
+	std::lock_guard<std::mutex> guard(registered_lock);
+	auto &specifiers = GetRegisteredFunctions(context).specifiers;
+	auto entry = specifiers.find(name);
+	if (entry == specifiers.end()) {
+		throw InvalidInputException("'" + name + "' was not created by pytables_register()");
+	}
+	return entry->second;
+}
+
+static unique_ptr<FunctionData> PyRegisteredBind(ClientContext &context, ScalarFunction &bound_function,
+                                                 vector<unique_ptr<Expression>> &arguments) {
+	// Resolved once per query, so execution needs neither a specifier argument nor a registry lookup
+	auto bind_data = make_uniq<PyScalarBindData>();
+	bind_data->function_specifier = RegisteredSpecifier(context, bound_function.name);
+	GILGuard gil;
+	bind_data->func = FunctionRegistry::Get().GetFunction(bind_data->function_specifier);
+	if (bind_data->func->declared_volatile()) {
+		bound_function.side_effects = FunctionSideEffects::HAS_SIDE_EFFECTS;
+	}
+	return std::move(bind_data);
+}
+
+static void PyRegisteredFunction(DataChunk &args, ExpressionState &state, Vector &result) {
+	auto &func_expr = (BoundFunctionExpression &)state.expr;
+	auto &bind_data = (PyScalarBindData &)*func_expr.bind_info;
+	auto gil_start = NowNanos();
+	GILGuard gil;
+	auto gil_acquired = NowNanos();
+	auto &context = state.GetContext();
+	PythonCallWatch watch(context, PythonTimeoutMillis(context));
+	if (!CallInstance(state, bind_data.function_specifier, args, 0, result, gil_start, gil_acquired, watch)) {
+		CallBoundFunction(state, bind_data, args, 0, result, gil_start, gil_acquired, watch);
+	}
+}
+
+static std::string RegisterFunction(ClientContext &context, const std::string &name, const std::string &funcspec,
+                                    const Value &arg_types, const std::string &return_type) {
+	// Fail now rather than when the function is first used
+	parse_func_specifier(funcspec);
+	{
+		GILGuard gil;
+		FunctionRegistry::Get().GetFunction(funcspec);
+	}
+
+	std::vector<LogicalType> arguments;
+	std::string signature;
+	for (auto &arg_type : ListValue::GetChildren(arg_types)) {
+		if (arg_type.IsNull()) {
+			throw InvalidInputException("pytables_register argument types must not be NULL");
+		}
+		arguments.push_back(TransformStringToLogicalType(arg_type.ToString(), context));
+		signature += (signature.empty() ? "" : ", ") + arguments.back().ToString();
+	}
+	auto returns = TransformStringToLogicalType(return_type, context);
+
+	ScalarFunction func(name, arguments, returns, PyRegisteredFunction, PyRegisteredBind, nullptr, nullptr,
+	                    PyScalarInitLocalState);
+	// Like pycall, NULLs are passed to Python as None rather than short circuiting the call
+	func.null_handling = FunctionNullHandling::SPECIAL_HANDLING;
+	CreateScalarFunctionInfo info(func);
+
+	// Replacing is only allowed for our own functions, never built in ones
+	{
+		std::lock_guard<std::mutex> guard(registered_lock);
+		if (GetRegisteredFunctions(context).specifiers.count(name)) {
+			info.on_conflict = OnCreateConflict::REPLACE_ON_CONFLICT;
+		}
+	}
+	Catalog::GetSystemCatalog(context).CreateFunction(context, info);
+	{
+		std::lock_guard<std::mutex> guard(registered_lock);
+		GetRegisteredFunctions(context).specifiers[name] = funcspec;
+	}
+	return name + "(" + signature + ") -> " + returns.ToString();
+}
+
+static void PyRegisterFunction(DataChunk &args, ExpressionState &state, Vector &result) {
+	auto &context = state.GetContext();
+	for (idx_t row = 0; row < args.size(); row++) {
+		auto name = args.data[0].GetValue(row);
+		auto funcspec = args.data[1].GetValue(row);
+		auto arg_types = args.data[2].GetValue(row);
+		auto return_type = args.data[3].GetValue(row);
+		if (name.IsNull() || funcspec.IsNull() || arg_types.IsNull() || return_type.IsNull()) {
+			throw InvalidInputException("pytables_register arguments must not be NULL");
+		}
+		auto registered =
+		    RegisterFunction(context, name.ToString(), funcspec.ToString(), arg_types, return_type.ToString());
+		result.SetValue(row, Value(registered));
+	}
+}
+
+CreateScalarFunctionInfo GetRegisterFunction() {
+	auto register_func = ScalarFunction(
+	    "pytables_register",
+	    {LogicalType::VARCHAR, LogicalType::VARCHAR, LogicalType::LIST(LogicalType::VARCHAR), LogicalType::VARCHAR},
+	    LogicalType::VARCHAR, PyRegisterFunction);
+	// Never constant fold this away
+	register_func.side_effects = FunctionSideEffects::HAS_SIDE_EFFECTS;
+	register_func.null_handling = FunctionNullHandling::SPECIAL_HANDLING;
+	return CreateScalarFunctionInfo(register_func);
+}
 } // namespace pyudf
@@ -0,0 +1,381 @@
+#include <Python.h>
+#include <stdexcept>
+#include <duckdb.hpp>
+#include <duckdb/common/arrow/arrow.hpp>
+#include <duckdb/common/arrow/arrow_converter.hpp>
+#include <duckdb/common/string_util.hpp>
+#include <duckdb/function/copy_function.hpp>
+#include <duckdb/parser/parsed_data/copy_info.hpp>
+#include <pysink.hpp>
+#include "python_function.hpp"
+#include "python_exception.hpp"
+#include "pycompat.hpp"
+#include "function_registry.hpp"
+#include "interpreter.hpp"
+#include "function_stats.hpp"
+#include "trace.hpp"
+#include "interrupt.hpp"
+#include <pyconvert.hpp>
+#include <log.hpp>
+
+using namespace duckdb;
+namespace pyudf {
+
+// Rows handed to Python at once unless the 'batch_size' option says otherwise. Batches are made of
+// whole chunks, so may run up to a chunk over.
+static const idx_t DEFAULT_BATCH_SIZE = STANDARD_VECTOR_SIZE * 32;
+
+// The target of a COPY ... (FORMAT python) is either a function, called with each batch, or a
+// sink class (eg a subclass of ducktables.Sink). Each DuckDB thread writing the results creates
+// its own instance of the class, calls its setup(), write(batch) for each batch, and flush() once
+// the thread has written its share. Whichever it is, the target's finalize() is called once after
+// every thread has finished.
+struct PySinkBindData : public TableFunctionData {
+	// The 'module:function' from the COPY's file name
+	std::string target;
+	std::shared_ptr<PythonFunction> func;
+	bool sink_class = false;
+
+	std::vector<std::string> names;
+	std::vector<LogicalType> types;
+	idx_t batch_size = DEFAULT_BATCH_SIZE;
+	// Batches are pyarrow Tables rather than dicts of lists
+	bool arrow = false;
+	ClientProperties client_properties;
+
+	std::shared_ptr<FunctionStats> stats;
+	uint64_t timeout_ms = 0;
+
+	~PySinkBindData() override {
+		GILGuard gil;
+		func.reset();
+	}
+};
+
+struct PySinkGlobalState : public GlobalFunctionData {
+	// For the 'arrow' format, the results' pyarrow.Schema and the functions importing chunks
+	// exported through the Arrow C data interface
+	PyObject *arrow_schema = nullptr;
+	PyObject *import_record_batch = nullptr;
+	PyObject *table_from_batches = nullptr;
+
+	~PySinkGlobalState() override {
+		GILGuard gil;
+		Py_XDECREF(arrow_schema);
+		Py_XDECREF(import_record_batch);
+		Py_XDECREF(table_from_batches);
+	}
+};
+
+struct PySinkLocalState : public LocalFunctionData {
+	// This thread's instance of a sink class, null for functions
+	PyObject *instance = nullptr;
+	// Called with each batch, the instance's write() or the function itself
+	PyObject *write = nullptr;
+	// Rows buffered for the next batch, as a list per column or a list of pyarrow RecordBatches
+	std::vector<PyObject *> columns;
+	PyObject *record_batches = nullptr;
+	idx_t buffered_rows = 0;
+	// Converts each column's values for the lists, caching repeated values
+	std::vector<unique_ptr<VectorConverter>> converters;
+
+	~PySinkLocalState() override {
+		GILGuard gil;
+		converters.clear();
+		for (auto column : columns) {
+			Py_XDECREF(column);
+		}
+		Py_XDECREF(record_batches);
+		Py_XDECREF(write);
+		Py_XDECREF(instance);
+	}
+};
+
+static std::string OptionString(const std::string &option, const vector<Value> &values) {
+	if (values.size() != 1 || values[0].IsNull()) {
+		throw BinderException("%s expects a single value", option);
+	}
+	return values[0].ToString();
+}
+
+static unique_ptr<FunctionData> PySinkBind(ClientContext &context, CopyInfo &info, vector<string> &names,
+                                           vector<LogicalType> &sql_types) {
+	auto result = make_uniq<PySinkBindData>();
+	result->target = info.file_path;
+	result->names = names;
+	result->types = sql_types;
+	result->client_properties = context.GetClientProperties();
+	for (auto &option : info.options) {
+		auto name = StringUtil::Lower(option.first);
+		if (name == "batch_size") {
+			auto batch_size = std::stoll(OptionString(name, option.second));
+			if (batch_size < 1) {
+				throw BinderException("batch_size must be at least 1");
+			}
+			result->batch_size = batch_size;
+		} else if (name == "batch_format") {
+			auto format = StringUtil::Lower(OptionString(name, option.second));
+			if (format != "lists" && format != "arrow") {
+				throw BinderException("batch_format must be 'lists' or 'arrow', not '%s'", format);
+			}
+			result->arrow = format == "arrow";
+		} else {
+			throw NotImplementedException("Unrecognized option for FORMAT python: %s", option.first);
+		}
+	}
+	if (!result->arrow) {
+		case_insensitive_set_t seen;
+		for (auto &name : names) {
+			if (!seen.insert(name).second) {
+				throw BinderException("Column '%s' appears twice, columns given to Python must have unique names",
+				                      name);
+			}
+		}
+	}
+
+	GILGuard gil;
+	result->func = FunctionRegistry::Get().GetFunction(result->target);
+	result->sink_class = PyType_Check(result->func->callable());
+	result->stats = StatsRegistry::Get().For(result->target);
+	result->timeout_ms = PythonTimeoutMillis(context);
+	return std::move(result);
+}
+
+// Calls a method of a sink, or an attribute of a function, if it has one
+static void CallHook(PySinkBindData &bind_data, PyObject *target, const char *hook, PythonCallWatch &watch) {
+	if (!PyObject_HasAttrString(target, hook)) {
+		return;
+	}
+	watch.BeginCall();
+	PyObject *result = PyObject_CallMethod(target, hook, nullptr);
+	watch.EndCall();
+	if (!result) {
+		PythonException error;
+		AddStat(bind_data.stats->exceptions, 1);
+		watch.ThrowIfInterrupted(bind_data.target);
+		throw std::runtime_error(bind_data.target + "." + hook + "() failed: " + error.message);
+	}
+	Py_DECREF(result);
+}
+
+static unique_ptr<GlobalFunctionData> PySinkInitGlobal(ClientContext &context, FunctionData &bind_data_p,
+                                                       const string &file_path) {
+	auto &bind_data = (PySinkBindData &)bind_data_p;
+	auto result = make_uniq<PySinkGlobalState>();
+	if (!bind_data.arrow) {
+		return std::move(result);
+	}
+
+	GILGuard gil;
+	PyObject *pyarrow = PyImport_ImportModule("pyarrow");
+	if (!pyarrow) {
+		PythonException error;
+		throw std::runtime_error("batch_format 'arrow' requires pyarrow: " + error.message);
+	}
+	PyObject *schema_class = PyObject_GetAttrString(pyarrow, "Schema");
+	PyObject *record_batch_class = PyObject_GetAttrString(pyarrow, "RecordBatch");
+	PyObject *table_class = PyObject_GetAttrString(pyarrow, "Table");
+	Py_DECREF(pyarrow);
+	if (schema_class && record_batch_class && table_class) {
+		result->import_record_batch = PyObject_GetAttrString(record_batch_class, "_import_from_c");
+		result->table_from_batches = PyObject_GetAttrString(table_class, "from_batches");
+		if (result->import_record_batch) {
+			ArrowSchema schema;
+			ArrowConverter::ToArrowSchema(&schema, bind_data.types, bind_data.names, bind_data.client_properties);
+			PyObject *import_schema = PyObject_GetAttrString(schema_class, "_import_from_c");
+			if (import_schema) {
+				result->arrow_schema = PyObject_CallFunction(import_schema, "n", (Py_ssize_t)(uintptr_t)&schema);
+				Py_DECREF(import_schema);
+			}
+			if (!result->arrow_schema && schema.release) {
+				schema.release(&schema);
+			}
+		}
+	}
+	Py_XDECREF(schema_class);
+	Py_XDECREF(record_batch_class);
+	Py_XDECREF(table_class);
+	if (!result->arrow_schema || !result->import_record_batch || !result->table_from_batches) {
+		PythonException error;
+		throw std::runtime_error("Failed to set up the pyarrow schema: " + error.message);
+	}
+	return std::move(result);
+}
+
+static unique_ptr<LocalFunctionData> PySinkInitLocal(ExecutionContext &context, FunctionData &bind_data_p) {
+	auto &bind_data = (PySinkBindData &)bind_data_p;
+	GILGuard gil;
+	auto result = make_uniq<PySinkLocalState>();
+	if (bind_data.arrow) {
+		result->record_batches = PyList_New(0);
+	} else {
+		for (auto &type : bind_data.types) {
+			result->columns.push_back(PyList_New(0));
+			result->converters.push_back(make_uniq<VectorConverter>(type));
+		}
+	}
+	if (!bind_data.sink_class) {
+		result->write = bind_data.func->callable();
+		Py_INCREF(result->write);
+		return std::move(result);
+	}
+
+	PythonCallWatch watch(context.client, bind_data.timeout_ms);
+	PythonException *error;
+	watch.BeginCall();
+	std::tie(result->instance, error) = bind_data.func->call(nullptr, 0);
+	watch.EndCall();
+	if (!result->instance) {
+		std::string message = error->message;
+		delete error;
+		watch.ThrowIfInterrupted(bind_data.target);
+		throw std::runtime_error("Failed to create " + bind_data.target + ": " + message);
+	}
+	result->write = PyObject_GetAttrString(result->instance, "write");
+	if (!result->write) {
+		PyErr_Clear();
+		throw std::runtime_error(bind_data.target + " has no write() method");
+	}
+	CallHook(bind_data, result->instance, "setup", watch);
+	return std::move(result);
+}
+
+// Hands the buffered rows to Python as a single batch
+static void WriteBatch(PySinkBindData &bind_data, PySinkGlobalState &global, PySinkLocalState &local,
+                       PythonCallWatch &watch) {
+	auto &tracer = Tracer::Get();
+	auto start = NowNanos();
+	PyObject *batch;
+	if (bind_data.arrow) {
+		batch = PyObject_CallFunctionObjArgs(global.table_from_batches, local.record_batches, global.arrow_schema,
+		                                     nullptr);
+		if (!batch) {
+			PythonException error;
+			throw std::runtime_error("Failed to build a pyarrow Table: " + error.message);
+		}
+		Py_DECREF(local.record_batches);
+		local.record_batches = PyList_New(0);
+	} else {
+		batch = PyDict_New();
+		for (idx_t i = 0; i < local.columns.size(); i++) {
+			PyDict_SetItemString(batch, bind_data.names[i].c_str(), local.columns[i]);
+			Py_DECREF(local.columns[i]);
+			local.columns[i] = PyList_New(0);
+		}
+	}
+	auto rows = local.buffered_rows;
+	local.buffered_rows = 0;
+
+	auto call_start = NowNanos();
+	watch.BeginCall();
+	PyObject *result = CallWithArgs(local.write, &batch, 1);
+	watch.EndCall();
+	auto call_end = NowNanos();
+	Py_DECREF(batch);
+	AddStat(bind_data.stats->calls, 1);
+	AddStat(bind_data.stats->python_ns, call_end - call_start);
+	AddStat(bind_data.stats->conversion_ns, call_start - start);
+	if (tracer.Enabled()) {
+		tracer.Record("PySink", bind_data.target, start, call_end, {{"rows", rows}});
+	}
+	if (!result) {
+		PythonException error;
+		AddStat(bind_data.stats->exceptions, 1);
+		watch.ThrowIfInterrupted(bind_data.target);
+		throw std::runtime_error(error.message);
+	}
+	Py_DECREF(result);
+}
+
+static void PySinkSink(ExecutionContext &context, FunctionData &bind_data_p, GlobalFunctionData &gstate,
+                       LocalFunctionData &lstate, DataChunk &input) {
+	auto &bind_data = (PySinkBindData &)bind_data_p;
+	auto &global = (PySinkGlobalState &)gstate;
+	auto &local = (PySinkLocalState &)lstate;
+	auto gil_start = NowNanos();
+	GILGuard gil;
+	auto start = NowNanos();
+	AddStat(bind_data.stats->gil_wait_ns, start - gil_start);
+
+	if (bind_data.arrow) {
+		ArrowArray array;
+		ArrowConverter::ToArrowArray(input, &array, bind_data.client_properties);
+		PyObject *record_batch = PyObject_CallFunction(global.import_record_batch, "nO",
+		                                               (Py_ssize_t)(uintptr_t)&array, global.arrow_schema);
+		if (!record_batch) {
+			PythonException error;
+			if (array.release) {
+				array.release(&array);
+			}
+			throw std::runtime_error("Failed to import a chunk into pyarrow: " + error.message);
+		}
+		PyList_Append(local.record_batches, record_batch);
+		Py_DECREF(record_batch);
+	} else {
+		for (idx_t col = 0; col < input.ColumnCount(); col++) {
+			auto &converter = *local.converters[col];
+			auto column = local.columns[col];
+			converter.SetVector(input.data[col], input.size());
+			for (idx_t row = 0; row < input.size(); row++) {
+				PyObject *item = converter.Convert(row);
+				PyList_Append(column, item);
+				Py_DECREF(item);
+			}
+		}
+	}
+	local.buffered_rows += input.size();
+	AddStat(bind_data.stats->rows, input.size());
+	AddStat(bind_data.stats->chunks, 1);
+	AddStat(bind_data.stats->conversion_ns, NowNanos() - start);
+
+	if (local.buffered_rows >= bind_data.batch_size) {
+		PythonCallWatch watch(context.client, bind_data.timeout_ms);
+		WriteBatch(bind_data, global, local, watch);
+	}
+}
+
+// A thread has written its share, hand over what's left and let its sink flush
+static void PySinkCombine(ExecutionContext &context, FunctionData &bind_data_p, GlobalFunctionData &gstate,
+                          LocalFunctionData &lstate) {
+	auto &bind_data = (PySinkBindData &)bind_data_p;
+	auto &global = (PySinkGlobalState &)gstate;
+	auto &local = (PySinkLocalState &)lstate;
+	GILGuard gil;
+	PythonCallWatch watch(context.client, bind_data.timeout_ms);
+	if (local.buffered_rows > 0) {
+		WriteBatch(bind_data, global, local, watch);
+	}
+	if (local.instance) {
+		CallHook(bind_data, local.instance, "flush", watch);
+	}
+}
+
+static void PySinkFinalize(ClientContext &context, FunctionData &bind_data_p, GlobalFunctionData &gstate) {
+	auto &bind_data = (PySinkBindData &)bind_data_p;
+	GILGuard gil;
+	PythonCallWatch watch(context, bind_data.timeout_ms);
+	CallHook(bind_data, bind_data.func->callable(), "finalize", watch);
+	debug("Finished writing to " + bind_data.target);
+}
+
+// Sinks run in parallel, one instance per thread, unless the results have to arrive in order
+static CopyFunctionExecutionMode PySinkExecutionMode(bool preserve_insertion_order, bool supports_batch_index) {
+	if (!preserve_insertion_order) {
+		return CopyFunctionExecutionMode::PARALLEL_COPY_TO_FILE;
+	}
+	return CopyFunctionExecutionMode::REGULAR_COPY_TO_FILE;
+}
+
+CopyFunction GetPythonCopyFunction() {
+	CopyFunction function("python");
+	function.copy_to_bind = PySinkBind;
+	function.copy_to_initialize_global = PySinkInitGlobal;
+	function.copy_to_initialize_local = PySinkInitLocal;
+	function.copy_to_sink = PySinkSink;
+	function.copy_to_combine = PySinkCombine;
+	function.copy_to_finalize = PySinkFinalize;
+	function.execution_mode = PySinkExecutionMode;
+	return function;
+}
+
+} // namespace pyudf
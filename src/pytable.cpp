@@ -1,6 +1,7 @@
 
 #include <Python.h>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
 #include <duckdb.hpp>
 #include <duckdb/parser/expression/constant_expression.hpp>
@@ -8,7 +9,16 @@
 #include <pytable.hpp>
 #include "python_function.hpp"
 #include "python_table_function.hpp"
+#include "function_registry.hpp"
+#include "interpreter.hpp"
+#include "function_stats.hpp"
+#include "trace.hpp"
+#include "python_memory.hpp"
+#include "interrupt.hpp"
+#include "cursor_store.hpp"
+#include "async_source.hpp"
 #include <pyconvert.hpp>
+#include <pyinfer.hpp>
 #include <log.hpp>
 
 #include <typeinfo>
@@ -16,23 +26,78 @@
 using namespace duckdb;
 namespace pyudf {
 
+// Number of rows pulled from the iterator to detect a schema when none was given
+static const idx_t DEFAULT_SAMPLE_SIZE = 100;
+
+// Rows per chunk once DuckDB is close to memory_limit, handing rows over sooner and checking our
+// memory reservation more often
+static const idx_t THROTTLED_CHUNK_SIZE = STANDARD_VECTOR_SIZE / 8;
+
+struct PyScanBindData;
+void FinalizePyTable(PyScanBindData &bind_data);
+
 struct PyScanBindData : public TableFunctionData {
 	// Function arguments coerced to a tuple used in Python calling semantics,
-	PyObject *arguments;
+	PyObject *arguments = nullptr;
 
 	// Keyword arguments coerced to a dict to be used in **kwarg calling semantics
-	PyObject *kwargs;
+	PyObject *kwargs = nullptr;
 
 	std::vector<LogicalType> return_types;
 
-	// Return value of the function specified
-	PyObject *function_result_iterable;
-
-	pyudf::PythonTableFunction *pyfunc;
+	// Iterator over the rows the function returns, see ScanIterator()
+	PyObject *function_result_iterable = nullptr;
+
+	// Rows consumed from the iterable at bind time to detect the schema. These are replayed
+	// at the start of the scan so they aren't lost.
+	std::vector<PyObject *> sample_rows;
+
+	std::shared_ptr<pyudf::PythonTableFunction> pyfunc;
+
+	// Matches the values of each row to the output columns
+	unique_ptr<RowConverter> row_converter;
+	// Detected VARCHAR columns that store the str() of other values, see InferColumnTypes()
+	std::vector<bool> stringified;
+
+	// Counters for this call of the function, also added to the totals reported by pytables_stats()
+	std::shared_ptr<ScanStats> stats;
+	// The 'module:function' the stats and trace spans are recorded under
+	std::string stats_key;
+
+	// Longest a single call into the function (or resumption of its iterator) may take, 0 for no
+	// limit. From the 'timeout_ms' argument, or the pytables_timeout_ms setting.
+	uint64_t timeout_ms = 0;
+
+	// Stream the function's cursor is saved under, from the 'cursor' argument. Empty if the scan
+	// isn't incremental.
+	std::string cursor_name;
+	// Newest cursor the function yielded, saved once the iterator is exhausted
+	PyObject *new_cursor = nullptr;
+	// Type of the last row that wasn't a cursor marker, so rows of that type skip the check
+	PyTypeObject *row_type = nullptr;
+
+	// Awaitable rows of an async source awaited at once, from the 'async_concurrency' argument
+	idx_t async_concurrency = DEFAULT_ASYNC_CONCURRENCY;
+
+	~PyScanBindData() override {
+		// Dropping these may free Python objects
+		GILGuard gil;
+		// Still set if the scan stopped early, eg for a LIMIT. Dropping an async source's
+		// iterator stops it gathering rows.
+		FinalizePyTable(*this);
+		Py_XDECREF(new_cursor);
+		row_converter.reset();
+		pyfunc.reset();
+	}
 };
 
 struct PyScanLocalState : public LocalTableFunctionState {
 	bool done = false;
+	// How many of the bind time sample rows have been emitted
+	idx_t sample_offset = 0;
+	// Accounts for Python's heap growth during the scan against memory_limit, created on the
+	// first chunk as it needs the GIL
+	unique_ptr<PythonMemoryReservation> memory;
 };
 
 struct PyScanGlobalState : public GlobalTableFunctionState {
@@ -42,19 +107,61 @@ struct PyScanGlobalState : public GlobalTableFunctionState {
 
 void FinalizePyTable(PyScanBindData &bind_data) {
 	// Free the iterable returned by our python function call
-	Py_DECREF(bind_data.function_result_iterable);
-	bind_data.function_result_iterable = nullptr;
+	Py_CLEAR(bind_data.function_result_iterable);
+
+	for (auto row : bind_data.sample_rows) {
+		Py_DECREF(row);
+	}
+	bind_data.sample_rows.clear();
+
+	// Free the arguments tuple, which frees each of its entries, and the keyword arguments
+	Py_CLEAR(bind_data.arguments);
+	Py_CLEAR(bind_data.kwargs);
+}
+
+// Returns true if 'row' is a cursor marker rather than a row, keeping the cursor it carries. The
+// last marker the function yields wins.
+static bool TakeCursor(PyScanBindData &bind_data, PyObject *row) {
+	if (Py_TYPE(row) == bind_data.row_type) {
+		return false;
+	}
+	PyObject *cursor = GetCursorMarker(row);
+	if (!cursor) {
+		bind_data.row_type = Py_TYPE(row);
+		return false;
+	}
+	Py_XDECREF(bind_data.new_cursor);
+	bind_data.new_cursor = cursor;
+	return true;
+}
 
-	// Free each entry of the arguments tuple and the tuple itself
-	Py_ssize_t size = PyTuple_Size(bind_data.arguments);
-	for (Py_ssize_t i = 0; i < size; i++) {
-		PyObject *arg = PyTuple_GetItem(bind_data.arguments, i);
-		Py_XDECREF(arg);
+// Saves the cursor the function yielded under the scan's stream, in the query's transaction
+static void SaveScanCursor(ClientContext &context, PyScanBindData &bind_data) {
+	if (bind_data.cursor_name.empty()) {
+		if (bind_data.new_cursor) {
+			debug(bind_data.stats_key + " yielded a cursor, but pytable() was called without 'cursor'");
+		}
+		return;
 	}
+	if (!bind_data.new_cursor) {
+		// Nothing new, the next run resumes from the same position
+		return;
+	}
+	SaveCursor(context, bind_data.cursor_name, CursorToJSON(bind_data.new_cursor, bind_data.cursor_name));
 }
 
 void PyScan(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto gil_start = NowNanos();
+	GILGuard gil;
+	auto now = NowNanos();
 	auto &bind_data = (PyScanBindData &)*data.bind_data;
+	auto &stats = *bind_data.stats;
+	stats.Add(&FunctionStats::gil_wait_ns, now - gil_start);
+	auto &tracer = Tracer::Get();
+	auto chunk_start = now;
+	if (tracer.Enabled()) {
+		tracer.Record("GIL", bind_data.stats_key, gil_start, now);
+	}
 
 	auto &local_state = (PyScanLocalState &)*data.local_state;
 
@@ -67,32 +174,68 @@ void PyScan(ClientContext &context, TableFunctionInput &data, DataChunk &output)
 		throw std::runtime_error("Where did our iterator go?");
 	}
 
+	if (!local_state.memory) {
+		local_state.memory = make_uniq<PythonMemoryReservation>(context);
+	}
+	idx_t max_records = NearMemoryLimit(context) ? THROTTLED_CHUNK_SIZE : STANDARD_VECTOR_SIZE;
+	PythonCallWatch watch(context, bind_data.timeout_ms);
+
 	PyObject *row;
-	int read_records = 0;
-	while ((read_records < STANDARD_VECTOR_SIZE) && (row = PyIter_Next(result))) {
-		auto iter_row = pyObjectToIterable(row);
-		// todo: acquire the GIL
-		if (PyErr_Occurred()) {
-			PythonException err;
-			// todo: release the GIL
-			throw std::runtime_error(err.message);
-		}
-		// todo: release the GIL
-		else if (!iter_row) {
-			// todo: cleanup?
-			throw std::runtime_error("Error: Row record not iterable as expected");
-		} else {
-			std::vector<duckdb::Value> duck_row = {};
-			ConvertPyObjectsToDuckDBValues(iter_row, bind_data.return_types, duck_row);
-			for (long unsigned int i = 0; i < duck_row.size(); i++) {
-				auto v = duck_row.at(i);
-				// todo: Am I doing this correctly? I have no idea.
-				output.SetValue(i, output.size(), v);
-			}
+	idx_t read_records = 0;
+	bool exhausted = false;
+	// Tallied locally and added to the shared counters once per chunk
+	uint64_t python_ns = 0;
+	uint64_t conversion_ns = 0;
+	uint64_t null_conversions = 0;
+	while (read_records < max_records) {
+		if (local_state.sample_offset < bind_data.sample_rows.size()) {
+			// Rows sampled at bind time are replayed before we resume the iterator
+			null_conversions += bind_data.row_converter->Convert(
+			    bind_data.sample_rows[local_state.sample_offset++], output, read_records++);
+			auto converted = NowNanos();
+			conversion_ns += converted - now;
+			now = converted;
+			continue;
+		}
+		watch.BeginCall();
+		row = PyIter_Next(result);
+		watch.EndCall();
+		auto converting = NowNanos();
+		python_ns += converting - now;
+		if (!row) {
+			exhausted = true;
+			break;
+		}
+		if (TakeCursor(bind_data, row)) {
 			Py_DECREF(row);
-			output.SetCardinality(output.size() + 1);
-			read_records++;
+			now = NowNanos();
+			continue;
+		}
+		// Values are written straight into the output vectors, nested types into their children
+		try {
+			null_conversions += bind_data.row_converter->Convert(row, output, read_records);
+		} catch (...) {
+			Py_DECREF(row);
+			throw;
 		}
+		Py_DECREF(row);
+		read_records++;
+		now = NowNanos();
+		conversion_ns += now - converting;
+	}
+	output.SetCardinality(read_records);
+	bind_data.row_converter->FinishChunk(output);
+	stats.Add(&FunctionStats::rows, read_records);
+	stats.Add(&FunctionStats::chunks, 1);
+	stats.Add(&FunctionStats::python_ns, python_ns);
+	stats.Add(&FunctionStats::conversion_ns, conversion_ns);
+	stats.Add(&FunctionStats::null_conversions, null_conversions);
+	if (tracer.Enabled()) {
+		tracer.Record("PyScan", bind_data.stats_key, chunk_start, NowNanos(),
+		              {{"rows", read_records},
+		               {"python_ns", python_ns},
+		               {"conversion_ns", conversion_ns},
+		               {"null_conversions", null_conversions}});
 	}
 
 	// PyIter_Next will return null if the iterator is exhausted or if an
@@ -100,18 +243,22 @@ void PyScan(ClientContext &context, TableFunctionInput &data, DataChunk &output)
 	// so at this point we need to check which of these is the case.
 	if (PyErr_Occurred()) {
 		PythonException error = PythonException();
+		stats.Add(&FunctionStats::exceptions, 1);
 
 		// Shouldn't be necessary, but mark our scan as complete for good measure.
 		local_state.done = true;
 
 		// Clean everything up
 		FinalizePyTable(bind_data);
+		watch.ThrowIfInterrupted(bind_data.stats_key);
 		throw std::runtime_error(error.message);
 	}
-	if (!row) {
+	local_state.memory->Update();
+	if (exhausted) {
 		// We've exhausted our iterator
 		local_state.done = true;
 		FinalizePyTable(bind_data);
+		SaveScanCursor(context, bind_data);
 		return;
 	}
 }
@@ -147,7 +294,7 @@ void PyBindFunctionAndArgs(ClientContext &context, TableFunctionBindInput &input
 		throw InvalidInputException("I don't know how logic works");
 	}
 
-	bind_data->pyfunc = new pyudf::PythonTableFunction(module_name, function_name);
+	bind_data->pyfunc = FunctionRegistry::Get().GetTableFunction(module_name, function_name);
 	bind_data->arguments = duckdbs_to_pys(arguments);
 	if (NULL == bind_data->arguments) {
 		throw IOException("Failed coerce function arguments");
@@ -161,9 +308,28 @@ void PyBindFunctionAndArgs(ClientContext &context, TableFunctionBindInput &input
 		}
 		bind_data->kwargs = duckdb_to_py(input_kwargs);
 	}
+
+	if (0 < params.count("cursor")) {
+		auto cursor_name = params["cursor"];
+		if (cursor_name.IsNull() || cursor_name.GetValue<std::string>().empty()) {
+			throw InvalidInputException("cursor must name the stream to save the function's position under");
+		}
+		bind_data->cursor_name = cursor_name.GetValue<std::string>();
+		if (!bind_data->kwargs) {
+			bind_data->kwargs = PyDict_New();
+		} else if (PyDict_GetItemString(bind_data->kwargs, "cursor")) {
+			throw InvalidInputException("kwargs can't contain 'cursor' when the cursor argument is given");
+		}
+		// None on the first run
+		PyObject *cursor = CursorFromJSON(LoadCursor(context, bind_data->cursor_name));
+		PyDict_SetItemString(bind_data->kwargs, "cursor", cursor);
+		Py_DECREF(cursor);
+	}
 }
 
-void PyBindColumnsAndTypes(ClientContext &context, TableFunctionBindInput &input, unique_ptr<PyScanBindData> &bind_data,
+// Returns false if neither a 'columns' argument nor type annotations were available, in which
+// case the schema needs to be detected from the rows the function returns.
+bool PyBindColumnsAndTypes(ClientContext &context, TableFunctionBindInput &input, unique_ptr<PyScanBindData> &bind_data,
                            std::vector<LogicalType> &return_types, std::vector<std::string> &names) {
 	auto names_and_types = input.named_parameters["columns"];
 	auto &child_type = names_and_types.type();
@@ -171,6 +337,10 @@ void PyBindColumnsAndTypes(ClientContext &context, TableFunctionBindInput &input
 		// Check if we can grab from the function
 		auto types = bind_data->pyfunc->column_types(bind_data->arguments, bind_data->kwargs);
 		if (types.empty()) {
+			auto auto_detect = input.named_parameters["auto_detect"];
+			if (auto_detect.IsNull() || auto_detect.GetValue<bool>()) {
+				return false;
+			}
 			// todo: Add a URL to an article on writing Python functions once said article exists
 			auto errMsg = "You did not specify a 'columns' argument, and your Python function does not have type "
 			              "annotations (or they are incompatible)";
@@ -199,7 +369,7 @@ void PyBindColumnsAndTypes(ClientContext &context, TableFunctionBindInput &input
 			throw InvalidInputException("Python function reported it contains zero columns");
 		}
 		bind_data->return_types = types;
-		return;
+		return true;
 	}
 	if (child_type.id() != LogicalTypeId::STRUCT) {
 		throw InvalidInputException("columns requires a struct mapping column names to data types");
@@ -219,31 +389,149 @@ void PyBindColumnsAndTypes(ClientContext &context, TableFunctionBindInput &input
 		throw BinderException("require at least a single column as input!");
 	}
 	bind_data->return_types = std::vector<LogicalType>(return_types);
+	return true;
 }
 
-unique_ptr<FunctionData> PyBind(ClientContext &context, TableFunctionBindInput &input,
-                                std::vector<LogicalType> &return_types, std::vector<std::string> &names) {
-	auto result = make_uniq<PyScanBindData>();
-	PyBindFunctionAndArgs(context, input, result);
-	PyBindColumnsAndTypes(context, input, result, return_types, names);
-	debug("PyBindColumnsAndTypes: Num Column Names:" + to_string(names.size()));
-	debug("PyBindColumnsAndTypes: Num Column types:" + to_string(return_types.size()));
+// Pulls up to 'sample_size' rows from the function's iterator, and detects the number of columns
+// and their types from them. The sampled rows are held on to so the scan can replay them.
+void PyInferColumnsAndTypes(ClientContext &context, TableFunctionBindInput &input,
+                            unique_ptr<PyScanBindData> &bind_data, std::vector<LogicalType> &return_types,
+                            std::vector<std::string> &names, PythonCallWatch &watch) {
+	idx_t sample_size = DEFAULT_SAMPLE_SIZE;
+	if (0 < input.named_parameters.count("sample_size")) {
+		auto sample_size_value = input.named_parameters["sample_size"].GetValue<int64_t>();
+		if (sample_size_value < 1) {
+			throw InvalidInputException("sample_size must be at least 1");
+		}
+		sample_size = sample_size_value;
+	}
+
+	// The sampled rows are held until the scan starts, so stop early if memory is tight
+	PyObject *row;
+	while (bind_data->sample_rows.size() < sample_size) {
+		watch.BeginCall();
+		row = PyIter_Next(bind_data->function_result_iterable);
+		watch.EndCall();
+		if (!row) {
+			break;
+		}
+		if (TakeCursor(*bind_data, row)) {
+			Py_DECREF(row);
+			continue;
+		}
+		bind_data->sample_rows.push_back(row);
+		if (NearMemoryLimit(context)) {
+			debug("Close to memory_limit, detecting the schema from " +
+			      std::to_string(bind_data->sample_rows.size()) + " rows");
+			break;
+		}
+	}
+	if (PyErr_Occurred()) {
+		PythonException error = PythonException();
+		bind_data->stats->Add(&FunctionStats::exceptions, 1);
+		FinalizePyTable(*bind_data);
+		watch.ThrowIfInterrupted(bind_data->stats_key);
+		throw std::runtime_error(error.message);
+	}
+	if (bind_data->sample_rows.empty()) {
+		FinalizePyTable(*bind_data);
+		throw InvalidInputException("You did not specify a 'columns' argument, and your Python function returned no "
+		                            "rows to detect them from");
+	}
+
+	std::vector<LogicalType> types;
+	std::vector<std::string> detected_names;
+	try {
+		types = InferColumnTypes(bind_data->sample_rows, detected_names, bind_data->stringified);
+	} catch (...) {
+		FinalizePyTable(*bind_data);
+		throw;
+	}
+	for (idx_t i = 0; i < types.size(); i++) {
+		names.push_back(detected_names.empty() ? "column" + std::to_string(i + 1) : detected_names[i]);
+		return_types.push_back(types[i]);
+	}
+	bind_data->return_types = types;
+}
+
+// Works out the columns, invokes the function, and samples its rows if the columns have to be
+// detected. Expects the function and its arguments to have been set on 'result'. The GIL must be
+// held, and was acquired between 'gil_start' and 'bind_start'.
+static void PyBindInvoke(ClientContext &context, TableFunctionBindInput &input, unique_ptr<PyScanBindData> &result,
+                         std::vector<LogicalType> &return_types, std::vector<std::string> &names, uint64_t gil_start,
+                         uint64_t bind_start) {
+	result->stats_key = result->pyfunc->module_name() + ":" + result->pyfunc->function_name();
+	result->stats = std::make_shared<ScanStats>(StatsRegistry::Get().For(result->stats_key));
+	result->stats->Add(&FunctionStats::gil_wait_ns, bind_start - gil_start);
+	auto &tracer = Tracer::Get();
+	tracer.Record("GIL", result->stats_key, gil_start, bind_start);
+	bool have_columns = PyBindColumnsAndTypes(context, input, result, return_types, names);
+	result->timeout_ms = PythonTimeoutMillis(context);
+	if (0 < input.named_parameters.count("timeout_ms")) {
+		auto timeout_value = input.named_parameters["timeout_ms"].GetValue<int64_t>();
+		if (timeout_value < 0) {
+			throw InvalidInputException("timeout_ms must not be negative");
+		}
+		result->timeout_ms = timeout_value;
+	}
+	if (0 < input.named_parameters.count("async_concurrency")) {
+		auto concurrency_value = input.named_parameters["async_concurrency"].GetValue<int64_t>();
+		if (concurrency_value < 1) {
+			throw InvalidInputException("async_concurrency must be at least 1");
+		}
+		result->async_concurrency = concurrency_value;
+	}
+	PythonCallWatch watch(context, result->timeout_ms);
 
 	// Invoke the function and grab a copy of the iterable it returns.
 	PyObject *iter;
 	PythonException *error;
+	auto call_start = NowNanos();
+	watch.BeginCall();
 	std::tie(iter, error) = result->pyfunc->call(result->arguments, result->kwargs);
+	watch.EndCall();
+	auto call_end = NowNanos();
+	result->stats->Add(&FunctionStats::calls, 1);
+	result->stats->Add(&FunctionStats::python_ns, call_end - call_start);
+	tracer.Record("python", result->stats_key, call_start, call_end);
 	if (!iter) {
+		result->stats->Add(&FunctionStats::exceptions, 1);
 		Py_XDECREF(iter);
 		std::string err = error->message;
 		error->~PythonException();
+		watch.ThrowIfInterrupted(result->stats_key);
 		throw std::runtime_error(err);
-	} else if (!PyIter_Check(iter)) {
-		Py_XDECREF(iter);
+	}
+	iter = ScanIterator(iter, result->async_concurrency);
+	if (!iter) {
 		throw std::runtime_error("Error: function '" + result->pyfunc->function_name() +
-		                         "' did not return an iterator\n");
+		                         "' did not return an iterator or async iterable\n");
 	}
 	result->function_result_iterable = iter;
+
+	if (!have_columns) {
+		// Dominated by resuming the iterator for the sample rows
+		auto sample_start = NowNanos();
+		PyInferColumnsAndTypes(context, input, result, return_types, names, watch);
+		auto sample_end = NowNanos();
+		result->stats->Add(&FunctionStats::python_ns, sample_end - sample_start);
+		tracer.Record("sample", result->stats_key, sample_start, sample_end,
+		              {{"rows", result->sample_rows.size()}});
+	}
+	result->row_converter = make_uniq<RowConverter>(return_types, names, result->stringified);
+	tracer.Record("PyBind", result->stats_key, bind_start, NowNanos());
+	debug("PyBindColumnsAndTypes: Num Column Names:" + to_string(names.size()));
+	debug("PyBindColumnsAndTypes: Num Column types:" + to_string(return_types.size()));
+}
+
+unique_ptr<FunctionData> PyBind(ClientContext &context, TableFunctionBindInput &input,
+                                std::vector<LogicalType> &return_types, std::vector<std::string> &names) {
+	auto gil_start = NowNanos();
+	GILGuard gil;
+	auto bind_start = NowNanos();
+	auto result = make_uniq<PyScanBindData>();
+	PyBindFunctionAndArgs(context, input, result);
+	PyBindInvoke(context, input, result, return_types, names, gil_start, bind_start);
 	return std::move(result);
 }
 
@@ -263,20 +551,427 @@ unique_ptr<LocalTableFunctionState> PyInitLocalState(ExecutionContext &context,
 	return std::move(local_state);
 }
 
+std::string PyToString(const FunctionData *bind_data_p) {
+	auto &bind_data = (const PyScanBindData &)*bind_data_p;
+	return bind_data.pyfunc->module_name() + ":" + bind_data.pyfunc->function_name() + "\n" +
+	       bind_data.stats->scan.ToString();
+}
+
+// pytable_multi('module:function', [argument sets]) calls the function once per argument set and
+// returns the union of the rows. Each call is a task that a DuckDB thread claims and scans to the
+// end before claiming another, so while one call waits on I/O with the GIL released, others can run.
+struct PyMultiBindData : public TableFunctionData {
+	// Each set is a STRUCT of keyword arguments, a LIST of positional arguments, or a single value
+	std::vector<Value> argument_sets;
+	// Keyword arguments passed with every set, a NULL value if there are none
+	Value shared_kwargs;
+
+	std::shared_ptr<PythonTableFunction> pyfunc;
+	std::string stats_key;
+	// Shared with the first argument set's bind data, whose call is counted along with the rest
+	std::shared_ptr<ScanStats> stats;
+	uint64_t timeout_ms = 0;
+	idx_t async_concurrency = DEFAULT_ASYNC_CONCURRENCY;
+
+	// The columns produced by the function, not counting the 'arguments' column
+	std::vector<LogicalType> function_types;
+	std::vector<std::string> function_names;
+	std::vector<bool> stringified;
+	bool include_arguments = false;
+	idx_t max_concurrency = 0;
+
+	// The first argument set was called while binding, to work out the columns. Its iterator and
+	// sample rows are picked up by the first scan of the query.
+	unique_ptr<PyScanBindData> first;
+
+	~PyMultiBindData() override {
+		GILGuard gil;
+		first.reset();
+		pyfunc.reset();
+	}
+};
+
+struct PyMultiGlobalState : public GlobalTableFunctionState {
+	std::mutex lock;
+	idx_t next_task = 0;
+	idx_t max_threads = 1;
+	// Taken over from the bind data's first call, for task 0
+	PyObject *started_iterator = nullptr;
+	std::vector<PyObject *> started_sample_rows;
+	// Shared by every thread, only touched while holding the GIL
+	unique_ptr<PythonMemoryReservation> memory;
+
+	idx_t MaxThreads() const override {
+		return max_threads;
+	}
+
+	~PyMultiGlobalState() override {
+		GILGuard gil;
+		Py_XDECREF(started_iterator);
+		for (auto row : started_sample_rows) {
+			Py_DECREF(row);
+		}
+		memory.reset();
+	}
+};
+
+struct PyMultiLocalState : public LocalTableFunctionState {
+	// The argument set being scanned, and the iterator its call returned
+	idx_t task = 0;
+	PyObject *iterator = nullptr;
+	std::vector<PyObject *> sample_rows;
+	idx_t sample_offset = 0;
+	unique_ptr<RowConverter> row_converter;
+	// Type of the last row that wasn't a cursor marker, so rows of that type skip the check
+	PyTypeObject *row_type = nullptr;
+
+	void ReleaseTask() {
+		Py_CLEAR(iterator);
+		for (auto row : sample_rows) {
+			Py_DECREF(row);
+		}
+		sample_rows.clear();
+		sample_offset = 0;
+	}
+
+	~PyMultiLocalState() override {
+		GILGuard gil;
+		ReleaseTask();
+		row_converter.reset();
+	}
+};
+
+// The positional and keyword arguments for a call with 'argument_set'. Keyword arguments from the
+// set take precedence over 'shared_kwargs'. The kwargs dict is null if there are none.
+static std::pair<PyObject *, PyObject *> ArgumentSetToPython(Value &argument_set, Value &shared_kwargs) {
+	PyObject *args;
+	PyObject *kwargs = nullptr;
+	if (argument_set.type().id() == LogicalTypeId::STRUCT) {
+		args = PyTuple_New(0);
+		kwargs = duckdb_to_py(argument_set);
+	} else if (argument_set.type().id() == LogicalTypeId::LIST) {
+		auto positional = ListValue::GetChildren(argument_set);
+		args = duckdbs_to_pys(positional);
+	} else {
+		std::vector<Value> positional {argument_set};
+		args = duckdbs_to_pys(positional);
+	}
+	if (!shared_kwargs.IsNull()) {
+		PyObject *merged = duckdb_to_py(shared_kwargs);
+		if (kwargs) {
+			PyDict_Update(merged, kwargs);
+			Py_DECREF(kwargs);
+		}
+		kwargs = merged;
+	}
+	return {args, kwargs};
+}
+
+unique_ptr<FunctionData> PyMultiBind(ClientContext &context, TableFunctionBindInput &input,
+                                     std::vector<LogicalType> &return_types, std::vector<std::string> &names) {
+	if (input.inputs.size() != 2 || input.inputs[0].type().id() != LogicalTypeId::VARCHAR) {
+		throw InvalidInputException("pytable_multi takes a 'module:func' string and a list of argument sets");
+	}
+	auto &sets = input.inputs[1];
+	if (sets.type().id() != LogicalTypeId::LIST || sets.IsNull()) {
+		throw InvalidInputException("pytable_multi's argument sets must be a list");
+	}
+	auto result = make_uniq<PyMultiBindData>();
+	result->argument_sets = ListValue::GetChildren(sets);
+	if (result->argument_sets.empty()) {
+		throw InvalidInputException("pytable_multi needs at least one argument set");
+	}
+	for (auto &argument_set : result->argument_sets) {
+		if (argument_set.IsNull()) {
+			throw InvalidInputException("pytable_multi's argument sets must not be NULL");
+		}
+	}
+	auto params = input.named_parameters;
+	if (0 < params.count("kwargs")) {
+		if (params["kwargs"].type().id() != LogicalTypeId::STRUCT) {
+			throw InvalidInputException("kwargs must be a struct mapping argument names to values");
+		}
+		result->shared_kwargs = params["kwargs"];
+	}
+	result->max_concurrency = result->argument_sets.size();
+	if (0 < params.count("max_concurrency")) {
+		auto max_concurrency = params["max_concurrency"].GetValue<int64_t>();
+		if (max_concurrency < 1) {
+			throw InvalidInputException("max_concurrency must be at least 1");
+		}
+		result->max_concurrency = MinValue<idx_t>(max_concurrency, result->max_concurrency);
+	}
+	if (0 < params.count("include_arguments")) {
+		result->include_arguments = params["include_arguments"].GetValue<bool>();
+	}
+
+	auto gil_start = NowNanos();
+	GILGuard gil;
+	auto bind_start = NowNanos();
+	std::string module_name;
+	std::string function_name;
+	std::tie(module_name, function_name) = parse_func_specifier(input.inputs[0].GetValue<std::string>());
+	result->first = make_uniq<PyScanBindData>();
+	result->first->pyfunc = FunctionRegistry::Get().GetTableFunction(module_name, function_name);
+	std::tie(result->first->arguments, result->first->kwargs) =
+	    ArgumentSetToPython(result->argument_sets[0], result->shared_kwargs);
+	PyBindInvoke(context, input, result->first, return_types, names, gil_start, bind_start);
+	result->pyfunc = result->first->pyfunc;
+	result->stats_key = result->first->stats_key;
+	result->stats = result->first->stats;
+	result->timeout_ms = result->first->timeout_ms;
+	result->async_concurrency = result->first->async_concurrency;
+	result->function_types = return_types;
+	result->function_names = names;
+	result->stringified = result->first->stringified;
+	if (result->include_arguments) {
+		names.push_back("arguments");
+		return_types.push_back(ListType::GetChildType(sets.type()));
+	}
+	return std::move(result);
+}
+
+unique_ptr<GlobalTableFunctionState> PyMultiInitGlobalState(ClientContext &context, TableFunctionInitInput &input) {
+	auto &bind_data = (PyMultiBindData &)*input.bind_data;
+	auto result = make_uniq<PyMultiGlobalState>();
+	result->max_threads = bind_data.max_concurrency;
+	GILGuard gil;
+	auto &first = *bind_data.first;
+	if (first.function_result_iterable) {
+		result->started_iterator = first.function_result_iterable;
+		Py_INCREF(result->started_iterator);
+		for (auto row : first.sample_rows) {
+			Py_INCREF(row);
+			result->started_sample_rows.push_back(row);
+		}
+		// Running the query again calls the first argument set afresh
+		FinalizePyTable(first);
+	}
+	result->memory = make_uniq<PythonMemoryReservation>(context);
+	return std::move(result);
+}
+
+unique_ptr<LocalTableFunctionState> PyMultiInitLocalState(ExecutionContext &context, TableFunctionInitInput &input,
+                                                          GlobalTableFunctionState *global_state) {
+	auto &bind_data = (PyMultiBindData &)*input.bind_data;
+	auto result = make_uniq<PyMultiLocalState>();
+	GILGuard gil;
+	result->row_converter =
+	    make_uniq<RowConverter>(bind_data.function_types, bind_data.function_names, bind_data.stringified);
+	return std::move(result);
+}
+
+// Claims the next argument set and calls the function with it. Returns false once every set has
+// been claimed.
+static bool PyMultiStartTask(PyMultiBindData &bind_data, PyMultiGlobalState &global, PyMultiLocalState &local,
+                             PythonCallWatch &watch) {
+	{
+		std::lock_guard<std::mutex> guard(global.lock);
+		if (global.next_task >= bind_data.argument_sets.size()) {
+			return false;
+		}
+		local.task = global.next_task++;
+		if (local.task == 0 && global.started_iterator) {
+			local.iterator = global.started_iterator;
+			local.sample_rows = std::move(global.started_sample_rows);
+			global.started_iterator = nullptr;
+			global.started_sample_rows.clear();
+			return true;
+		}
+	}
+
+	PyObject *args;
+	PyObject *kwargs;
+	std::tie(args, kwargs) = ArgumentSetToPython(bind_data.argument_sets[local.task], bind_data.shared_kwargs);
+	PyObject *iter;
+	PythonException *error;
+	auto call_start = NowNanos();
+	watch.BeginCall();
+	std::tie(iter, error) = bind_data.pyfunc->call(args, kwargs);
+	watch.EndCall();
+	auto call_end = NowNanos();
+	Py_DECREF(args);
+	Py_XDECREF(kwargs);
+	bind_data.stats->Add(&FunctionStats::calls, 1);
+	bind_data.stats->Add(&FunctionStats::python_ns, call_end - call_start);
+	Tracer::Get().Record("python", bind_data.stats_key, call_start, call_end, {{"argument_set", local.task}});
+	if (!iter) {
+		bind_data.stats->Add(&FunctionStats::exceptions, 1);
+		std::string err = error->message;
+		error->~PythonException();
+		watch.ThrowIfInterrupted(bind_data.stats_key);
+		throw std::runtime_error(err);
+	}
+	iter = ScanIterator(iter, bind_data.async_concurrency);
+	if (!iter) {
+		throw std::runtime_error("Error: function '" + bind_data.pyfunc->function_name() +
+		                         "' did not return an iterator or async iterable\n");
+	}
+	local.iterator = iter;
+	return true;
+}
+
+// Returns true if 'row' is a cursor marker rather than a row, as yielded by functions that also
+// support incremental scans with pytable()
+static bool IsCursorMarker(PyMultiLocalState &local, PyObject *row) {
+	if (Py_TYPE(row) == local.row_type) {
+		return false;
+	}
+	PyObject *cursor = GetCursorMarker(row);
+	if (!cursor) {
+		local.row_type = Py_TYPE(row);
+		return false;
+	}
+	Py_DECREF(cursor);
+	return true;
+}
+
+// Each chunk holds rows from a single argument set, so the 'arguments' column is a constant
+void PyMultiScan(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &bind_data = (PyMultiBindData &)*data.bind_data;
+	auto &global = (PyMultiGlobalState &)*data.global_state;
+	auto &local = (PyMultiLocalState &)*data.local_state;
+	auto gil_start = NowNanos();
+	GILGuard gil;
+	auto now = NowNanos();
+	auto &stats = *bind_data.stats;
+	stats.Add(&FunctionStats::gil_wait_ns, now - gil_start);
+	auto &tracer = Tracer::Get();
+	auto chunk_start = now;
+	if (tracer.Enabled()) {
+		tracer.Record("GIL", bind_data.stats_key, gil_start, now);
+	}
+
+	idx_t max_records = NearMemoryLimit(context) ? THROTTLED_CHUNK_SIZE : STANDARD_VECTOR_SIZE;
+	PythonCallWatch watch(context, bind_data.timeout_ms);
+	idx_t read_records = 0;
+	uint64_t python_ns = 0;
+	uint64_t conversion_ns = 0;
+	uint64_t null_conversions = 0;
+	while (read_records == 0) {
+		if (!local.iterator) {
+			if (!PyMultiStartTask(bind_data, global, local, watch)) {
+				break;
+			}
+			now = NowNanos();
+		}
+		bool exhausted = false;
+		while (read_records < max_records) {
+			if (local.sample_offset < local.sample_rows.size()) {
+				null_conversions +=
+				    local.row_converter->Convert(local.sample_rows[local.sample_offset++], output, read_records++);
+				auto converted = NowNanos();
+				conversion_ns += converted - now;
+				now = converted;
+				continue;
+			}
+			watch.BeginCall();
+			PyObject *row = PyIter_Next(local.iterator);
+			watch.EndCall();
+			auto converting = NowNanos();
+			python_ns += converting - now;
+			if (!row) {
+				exhausted = true;
+				break;
+			}
+			if (IsCursorMarker(local, row)) {
+				// There's no stream to save it under, pytable_multi doesn't take a 'cursor'
+				Py_DECREF(row);
+				now = NowNanos();
+				continue;
+			}
+			try {
+				null_conversions += local.row_converter->Convert(row, output, read_records);
+			} catch (...) {
+				Py_DECREF(row);
+				throw;
+			}
+			Py_DECREF(row);
+			read_records++;
+			now = NowNanos();
+			conversion_ns += now - converting;
+		}
+		if (PyErr_Occurred()) {
+			PythonException error = PythonException();
+			stats.Add(&FunctionStats::exceptions, 1);
+			local.ReleaseTask();
+			watch.ThrowIfInterrupted(bind_data.stats_key);
+			throw std::runtime_error(error.message);
+		}
+		if (exhausted && read_records == 0) {
+			local.ReleaseTask();
+		} else if (exhausted) {
+			// Emit what we have, the next call moves on to another argument set
+			local.ReleaseTask();
+			break;
+		}
+	}
+	output.SetCardinality(read_records);
+	local.row_converter->FinishChunk(output);
+	if (bind_data.include_arguments && read_records > 0) {
+		output.data[bind_data.function_types.size()].Reference(bind_data.argument_sets[local.task]);
+	}
+	stats.Add(&FunctionStats::rows, read_records);
+	stats.Add(&FunctionStats::chunks, 1);
+	stats.Add(&FunctionStats::python_ns, python_ns);
+	stats.Add(&FunctionStats::conversion_ns, conversion_ns);
+	stats.Add(&FunctionStats::null_conversions, null_conversions);
+	if (tracer.Enabled()) {
+		tracer.Record("PyScan", bind_data.stats_key, chunk_start, NowNanos(),
+		              {{"rows", read_records},
+		               {"argument_set", local.task},
+		               {"python_ns", python_ns},
+		               {"conversion_ns", conversion_ns},
+		               {"null_conversions", null_conversions}});
+	}
+	global.memory->Update();
+}
+
+std::string PyMultiToString(const FunctionData *bind_data_p) {
+	auto &bind_data = (const PyMultiBindData &)*bind_data_p;
+	return bind_data.stats_key + "\n" + std::to_string(bind_data.argument_sets.size()) + " argument sets\n" +
+	       bind_data.stats->scan.ToString();
+}
+
 unique_ptr<CreateTableFunctionInfo> GetPythonTableFunction() {
 	auto py_table_function = duckdb::TableFunction("pytable", {}, PyScan, (table_function_bind_t)PyBind,
 	                                               PyInitGlobalState, PyInitLocalState);
 
 	// todo: don't configure this for older versions of duckdb
 	py_table_function.varargs = LogicalType::ANY;
+	py_table_function.to_string = PyToString;
 
 	py_table_function.named_parameters["module"] = LogicalType::VARCHAR;
 	py_table_function.named_parameters["func"] = LogicalType::VARCHAR;
 	py_table_function.named_parameters["columns"] = LogicalType::ANY;
 	py_table_function.named_parameters["kwargs"] = LogicalType::ANY;
+	py_table_function.named_parameters["auto_detect"] = LogicalType::BOOLEAN;
+	py_table_function.named_parameters["sample_size"] = LogicalType::BIGINT;
+	py_table_function.named_parameters["timeout_ms"] = LogicalType::BIGINT;
+	py_table_function.named_parameters["cursor"] = LogicalType::VARCHAR;
+	py_table_function.named_parameters["async_concurrency"] = LogicalType::BIGINT;
 
 	CreateTableFunctionInfo py_table_function_info(py_table_function);
 	return make_uniq<CreateTableFunctionInfo>(py_table_function_info);
 }
 
+unique_ptr<CreateTableFunctionInfo> GetPythonTableMultiFunction() {
+	auto multi_function = duckdb::TableFunction("pytable_multi", {}, PyMultiScan, (table_function_bind_t)PyMultiBind,
+	                                            PyMultiInitGlobalState, PyMultiInitLocalState);
+	multi_function.varargs = LogicalType::ANY;
+	multi_function.to_string = PyMultiToString;
+
+	multi_function.named_parameters["columns"] = LogicalType::ANY;
+	multi_function.named_parameters["kwargs"] = LogicalType::ANY;
+	multi_function.named_parameters["auto_detect"] = LogicalType::BOOLEAN;
+	multi_function.named_parameters["sample_size"] = LogicalType::BIGINT;
+	multi_function.named_parameters["timeout_ms"] = LogicalType::BIGINT;
+	multi_function.named_parameters["max_concurrency"] = LogicalType::BIGINT;
+	multi_function.named_parameters["include_arguments"] = LogicalType::BOOLEAN;
+	multi_function.named_parameters["async_concurrency"] = LogicalType::BIGINT;
+
+	CreateTableFunctionInfo multi_function_info(multi_function);
+	return make_uniq<CreateTableFunctionInfo>(multi_function_info);
+}
+
 } // namespace pyudf
@@ -1,22 +1,37 @@
 #define DUCKDB_EXTENSION_MAIN
 
-#include <dlfcn.h>
-#include <iostream>
-#include "config.h"
+#include <cstdlib>
 #include <Python.h>
+#include "interpreter.hpp"
 #include "pyscalar.hpp"
 #include "pytable.hpp"
+#include "pysink.hpp"
+#include "function_registry.hpp"
+#include "function_stats.hpp"
+#include "trace.hpp"
+#include "python_memory.hpp"
+#include "interrupt.hpp"
 #include "pytables_extension.hpp"
 #include "duckdb.hpp"
 #include "duckdb/common/exception.hpp"
 #include "duckdb/common/string_util.hpp"
+#include "duckdb/main/config.hpp"
 #include "duckdb/function/scalar_function.hpp"
 
 #include <duckdb/parser/parsed_data/create_scalar_function_info.hpp>
+#include <duckdb/parser/parsed_data/create_copy_function_info.hpp>
 #include <typeinfo>
 
 namespace duckdb {
 
+static void SetPreloadModules(ClientContext &context, SetScope scope, Value &parameter) {
+	pyudf::PreloadModules(pyudf::ParseModuleList(parameter.ToString()));
+}
+
+static void SetTraceFile(ClientContext &context, SetScope scope, Value &parameter) {
+	pyudf::Tracer::Get().Start(parameter.IsNull() ? "" : parameter.ToString());
+}
+
 static void LoadInternal(DatabaseInstance &instance) {
 	Connection con(instance);
 	con.BeginTransaction();
@@ -28,39 +43,43 @@ static void LoadInternal(DatabaseInstance &instance) {
 	// pytables_fun_info.on_conflict = OnCreateConflict::ALTER_ON_CONFLICT;
 	catalog.CreateFunction(*con.context, python_scalar);
 
+	auto python_reload = pyudf::GetReloadFunction();
+	catalog.CreateFunction(*con.context, python_reload);
+
+	auto python_register = pyudf::GetRegisterFunction();
+	catalog.CreateFunction(*con.context, python_register);
+
 	// pyudf::GetPythonTableFunction();
 	auto python_table = pyudf::GetPythonTableFunction();
 	catalog.CreateTableFunction(context, python_table.get());
 
-	// Initialize the Python interpreter
-	Py_Initialize();
-
-	// Python C Extensions will encounter errors about missing symbols unless
-	// we eplicitly load the entire contents of the shared library. We do this
-	// with the dlopen() function which takes the path to the shared library. This
-	// can create some issues! Most notably where is the library and/or which one
-	// should we load. Our strategy at this time is to check if the user has
-	// supplied us a path to the file via an environment variable, look up the path
-	// via reflection on one of the preloaded symbols, and finally to "guess" the
-	// file name via some heuristics.
-	const char *libpath;
-	libpath = std::getenv("LIBPYTHONSO_PATH");
-	if (!libpath) {
-		// No env variable. Try examining a preloaded symbol.
-		Dl_info info;
-		if ((dladdr((void *)Py_Initialize, &info)) && (info.dli_fname)) {
-			libpath = info.dli_fname;
-		} else {
-			// Issue doing symbol lookup, fallback to our "guess"
-			libpath = PYTHON_LIB_NAME;
-		}
-	}
-	void *libpython = dlopen(libpath, RTLD_NOW | RTLD_GLOBAL);
-	if (!libpython) {
-		std::cerr << "Failed to dyanmically load your libpython shared library: " << PYTHON_LIB_NAME
-		          << ". You may see errors about missing symbols." << std::endl;
-		auto errMsg = dlerror();
-		std::cerr << "Error Details: " << errMsg << std::endl;
+	auto python_table_multi = pyudf::GetPythonTableMultiFunction();
+	catalog.CreateTableFunction(context, python_table_multi.get());
+
+	auto python_stats = pyudf::GetStatsFunction();
+	catalog.CreateTableFunction(context, python_stats.get());
+
+	auto python_copy = pyudf::GetPythonCopyFunction();
+	CreateCopyFunctionInfo python_copy_info(python_copy);
+	catalog.CreateCopyFunction(context, python_copy_info);
+
+	// The interpreter itself is started on first use, see EnsureInterpreter()
+	auto &config = DBConfig::GetConfig(instance);
+	config.AddExtensionOption("pytables_preload_modules",
+	                          "Comma separated list of Python modules to import in the background", LogicalType::VARCHAR,
+	                          Value(""), SetPreloadModules);
+	config.AddExtensionOption("pytables_track_memory",
+	                          "Reserve memory used by Python objects during pytable scans against memory_limit",
+	                          LogicalType::BOOLEAN, Value::BOOLEAN(pyudf::PythonMemoryTrackingDefault()));
+	config.AddExtensionOption("pytables_trace_file",
+	                          "Path to write a Chrome Trace Event file of Python execution to, empty to disable",
+	                          LogicalType::VARCHAR, Value(""), SetTraceFile);
+	config.AddExtensionOption("pytables_timeout_ms",
+	                          "Milliseconds a single call into Python may run before it is interrupted, 0 for no limit",
+	                          LogicalType::BIGINT, Value::BIGINT(0));
+	auto preload_modules = std::getenv("PYTABLES_PRELOAD_MODULES");
+	if (preload_modules) {
+		pyudf::PreloadModules(pyudf::ParseModuleList(preload_modules));
 	}
 	con.Commit();
 }
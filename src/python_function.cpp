@@ -1,6 +1,7 @@
 #include <duckdb.hpp>
 #include <python_function.hpp>
 #include <python_exception.hpp>
+#include <pycompat.hpp>
 #include <stdexcept>
 #include <typeinfo>
 
@@ -22,6 +23,8 @@ void PythonFunction::init(const std::string &module_name, const std::string &fun
 	function_name_ = function_name;
 	module = nullptr;
 	function = nullptr;
+	volatile_ = false;
+	udf_class_ = false;
 	PyObject *module_obj = PyImport_ImportModule(module_name.c_str());
 	if (!module_obj) {
 		PyErr_Print();
@@ -41,6 +44,16 @@ void PythonFunction::init(const std::string &module_name, const std::string &fun
 		throw std::runtime_error("Function is not callable: " + function_name);
 	}
 	function = function_obj;
+
+	PyObject *declared = PyObject_GetAttrString(function, "__ducktables_deterministic__");
+	if (declared) {
+		volatile_ = PyObject_IsTrue(declared) == 0;
+		Py_DECREF(declared);
+	}
+	PyErr_Clear();
+
+	udf_class_ = PyType_Check(function) &&
+	             (PyObject_HasAttrString(function, "setup") || PyObject_HasAttrString(function, "process_batch"));
 }
 
 PythonFunction::~PythonFunction() {
@@ -70,6 +83,110 @@ std::pair<PyObject *, PythonException *> PythonFunction::call(PyObject *args) co
 	}
 }
 
+std::pair<PyObject *, PythonException *> PythonFunction::call(PyObject *const *args, size_t nargs) const {
+	PyObject *result = CallWithArgs(function, args, nargs);
+
+	if (result == nullptr) {
+		PythonException *error = new PythonException();
+		return std::make_pair(nullptr, error);
+	} else {
+		return std::make_pair(result, nullptr);
+	}
+}
+
+std::pair<PyObject *, PythonException *> PythonFunction::call(CallArguments &args) const {
+	PyObject *result = args.Call(function);
+
+	if (result == nullptr) {
+		PythonException *error = new PythonException();
+		return std::make_pair(nullptr, error);
+	} else {
+		return std::make_pair(result, nullptr);
+	}
+}
+
+// Calls an optional no argument method, throwing if it fails
+static void CallHook(PyObject *instance, const char *name, const std::string &class_name) {
+	if (!PyObject_HasAttrString(instance, name)) {
+		return;
+	}
+	PyObject *result = PyObject_CallMethod(instance, name, nullptr);
+	if (!result) {
+		PythonException error;
+		throw std::runtime_error(class_name + "." + name + "() failed: " + error.message);
+	}
+	Py_DECREF(result);
+}
+
+PythonUDFInstance::PythonUDFInstance(const PythonFunction &udf_class) : instance(nullptr), process_batch(nullptr) {
+	auto class_name = udf_class.function_name();
+	PythonException *error;
+	std::tie(instance, error) = udf_class.call(nullptr, 0);
+	if (!instance) {
+		std::string message = error->message;
+		delete error;
+		throw std::runtime_error("Failed to create " + class_name + ": " + message);
+	}
+	try {
+		CallHook(instance, "setup", class_name);
+	} catch (...) {
+		Py_DECREF(instance);
+		throw;
+	}
+	process_batch = PyObject_GetAttrString(instance, "process_batch");
+	if (!process_batch) {
+		PyErr_Clear();
+	}
+}
+
+PythonUDFInstance::~PythonUDFInstance() {
+	Py_XDECREF(process_batch);
+	if (PyObject_HasAttrString(instance, "teardown")) {
+		PyObject *result = PyObject_CallMethod(instance, "teardown", nullptr);
+		if (result) {
+			Py_DECREF(result);
+		} else {
+			// Nowhere to report it, the query has already produced its results
+			PyErr_Print();
+		}
+	}
+	Py_DECREF(instance);
+}
+
+std::pair<PyObject *, PythonException *> PythonUDFInstance::call(PyObject *const *args, size_t nargs) const {
+	PyObject *result = CallWithArgs(instance, args, nargs);
+
+	if (result == nullptr) {
+		PythonException *error = new PythonException();
+		return std::make_pair(nullptr, error);
+	} else {
+		return std::make_pair(result, nullptr);
+	}
+}
+
+std::pair<PyObject *, PythonException *> PythonUDFInstance::call(CallArguments &args) const {
+	PyObject *result = args.Call(instance);
+
+	if (result == nullptr) {
+		PythonException *error = new PythonException();
+		return std::make_pair(nullptr, error);
+	} else {
+		return std::make_pair(result, nullptr);
+	}
+}
+
+std::pair<PyObject *, PythonException *> PythonUDFInstance::call_batch(PyObject *const *columns,
+                                                                       size_t ncolumns) const {
+	PyObject *result = CallWithArgs(process_batch, columns, ncolumns);
+
+	if (result == nullptr) {
+		PythonException *error = new PythonException();
+		return std::make_pair(nullptr, error);
+	} else {
+		return std::make_pair(result, nullptr);
+	}
+}
+
 std::pair<std::string, std::string> parse_func_specifier(std::string specifier) {
 	auto delim_location = specifier.find(":");
 	if (delim_location == std::string::npos) {
@@ -0,0 +1,212 @@
+#include <python_memory.hpp>
+#include <log.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <duckdb/common/exception.hpp>
+#include <duckdb/common/string_util.hpp>
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+namespace pyudf {
+
+// Fraction of memory_limit past which NearMemoryLimit() reports pressure
+static const double MEMORY_PRESSURE_THRESHOLD = 0.9;
+
+#ifndef Py_LIMITED_API
+// Bytes handed out by the hooked allocators. Blocks allocated before the hooks were installed
+// are subtracted when freed, so this may dip below zero; callers only look at growth.
+static std::atomic<int64_t> allocated_bytes {0};
+static PyMemAllocatorEx raw_allocator;
+static PyObjectArenaAllocator arena_allocator;
+static bool hooks_installed = false;
+
+static inline size_t UsableSize(void *ptr) {
+#ifdef __APPLE__
+	return malloc_size(ptr);
+#else
+	return malloc_usable_size(ptr);
+#endif
+}
+
+// The raw domain is backed by malloc(), so we can ask it for the size of a block when it's
+// freed rather than storing sizes ourselves. pymalloc, which serves the mem and object domains,
+// gets its memory from the raw domain (for large blocks) and from arenas, both of which we hook.
+static void *RawMalloc(void *ctx, size_t size) {
+	void *ptr = raw_allocator.malloc(raw_allocator.ctx, size);
+	if (ptr) {
+		allocated_bytes.fetch_add(UsableSize(ptr), std::memory_order_relaxed);
+	}
+	return ptr;
+}
+
+static void *RawCalloc(void *ctx, size_t nelem, size_t elsize) {
+	void *ptr = raw_allocator.calloc(raw_allocator.ctx, nelem, elsize);
+	if (ptr) {
+		allocated_bytes.fetch_add(UsableSize(ptr), std::memory_order_relaxed);
+	}
+	return ptr;
+}
+
+static void *RawRealloc(void *ctx, void *ptr, size_t new_size) {
+	int64_t old_size = ptr ? UsableSize(ptr) : 0;
+	void *new_ptr = raw_allocator.realloc(raw_allocator.ctx, ptr, new_size);
+	if (new_ptr) {
+		allocated_bytes.fetch_add((int64_t)UsableSize(new_ptr) - old_size, std::memory_order_relaxed);
+	}
+	return new_ptr;
+}
+
+static void RawFree(void *ctx, void *ptr) {
+	if (ptr) {
+		allocated_bytes.fetch_sub(UsableSize(ptr), std::memory_order_relaxed);
+	}
+	raw_allocator.free(raw_allocator.ctx, ptr);
+}
+
+static void *ArenaAlloc(void *ctx, size_t size) {
+	void *ptr = arena_allocator.alloc(arena_allocator.ctx, size);
+	if (ptr) {
+		allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+	return ptr;
+}
+
+static void ArenaFree(void *ctx, void *ptr, size_t size) {
+	allocated_bytes.fetch_sub(size, std::memory_order_relaxed);
+	arena_allocator.free(arena_allocator.ctx, ptr, size);
+}
+#endif
+
+void InstallPythonMemoryHooks() {
+#ifndef Py_LIMITED_API
+	// A custom allocator (eg PYTHONMALLOC=debug) may not be malloc() underneath, in which case
+	// we can't size its blocks
+	if (hooks_installed || std::getenv("PYTHONMALLOC")) {
+		return;
+	}
+	PyMem_GetAllocator(PYMEM_DOMAIN_RAW, &raw_allocator);
+	PyMemAllocatorEx counting_raw = {nullptr, RawMalloc, RawCalloc, RawRealloc, RawFree};
+	PyMem_SetAllocator(PYMEM_DOMAIN_RAW, &counting_raw);
+
+	PyObject_GetArenaAllocator(&arena_allocator);
+	PyObjectArenaAllocator counting_arena = {nullptr, ArenaAlloc, ArenaFree};
+	PyObject_SetArenaAllocator(&counting_arena);
+	hooks_installed = true;
+#endif
+}
+
+// tracemalloc.get_traced_memory, once tracemalloc has been started. Looked up once rather than
+// for every chunk, and kept for the life of the interpreter.
+static PyObject *get_traced_memory = nullptr;
+
+static bool StartTracemalloc() {
+	if (get_traced_memory) {
+		return true;
+	}
+	PyObject *tracemalloc = PyImport_ImportModule("tracemalloc");
+	PyObject *result = tracemalloc ? PyObject_CallMethod(tracemalloc, "start", nullptr) : nullptr;
+	if (result) {
+		get_traced_memory = PyObject_GetAttrString(tracemalloc, "get_traced_memory");
+	}
+	Py_XDECREF(result);
+	Py_XDECREF(tracemalloc);
+	if (!get_traced_memory) {
+		PyErr_Clear();
+		debug("Failed to start tracemalloc, Python memory won't be tracked");
+		return false;
+	}
+	return true;
+}
+
+static int64_t TracedMemory() {
+	PyObject *traced = PyObject_CallObject(get_traced_memory, nullptr);
+	int64_t current = 0;
+	if (traced && PyTuple_Check(traced) && PyTuple_Size(traced) == 2) {
+		current = PyLong_AsLongLong(PyTuple_GetItem(traced, 0));
+	}
+	Py_XDECREF(traced);
+	PyErr_Clear();
+	return current;
+}
+
+bool StartPythonMemoryTracking() {
+#ifndef Py_LIMITED_API
+	if (hooks_installed) {
+		return true;
+	}
+	// The interpreter was started by the process we were loaded into (or with PYTHONMALLOC set),
+	// so the hooks couldn't be installed
+#endif
+	return StartTracemalloc();
+}
+
+int64_t PythonMemoryUsage() {
+#ifndef Py_LIMITED_API
+	if (hooks_installed) {
+		return allocated_bytes.load(std::memory_order_relaxed);
+	}
+#endif
+	return get_traced_memory ? TracedMemory() : 0;
+}
+
+bool PythonMemoryTrackingDefault() {
+#ifndef Py_LIMITED_API
+	// Only when the hooks will be installed, see EnsureInterpreter()
+	return !Py_IsInitialized() && !std::getenv("PYTHONMALLOC");
+#else
+	return false;
+#endif
+}
+
+bool PythonMemoryTrackingEnabled(duckdb::ClientContext &context) {
+	duckdb::Value enabled;
+	if (!context.TryGetCurrentSetting("pytables_track_memory", enabled) || enabled.IsNull()) {
+		return false;
+	}
+	return enabled.GetValue<bool>();
+}
+
+bool NearMemoryLimit(duckdb::ClientContext &context) {
+	auto &buffer_manager = duckdb::BufferManager::GetBufferManager(context);
+	auto max_memory = buffer_manager.GetMaxMemory();
+	return max_memory > 0 && (double)buffer_manager.GetUsedMemory() > MEMORY_PRESSURE_THRESHOLD * (double)max_memory;
+}
+
+PythonMemoryReservation::PythonMemoryReservation(duckdb::ClientContext &context)
+    : buffer_manager(duckdb::BufferManager::GetBufferManager(context)),
+      enabled(PythonMemoryTrackingEnabled(context) && StartPythonMemoryTracking()) {
+	if (enabled) {
+		baseline = PythonMemoryUsage();
+	}
+}
+
+PythonMemoryReservation::~PythonMemoryReservation() {
+	if (reserved) {
+		buffer_manager.FreeReservedMemory(reserved);
+	}
+}
+
+void PythonMemoryReservation::Update() {
+	if (!enabled) {
+		return;
+	}
+	auto growth = PythonMemoryUsage() - baseline;
+	auto target = growth > 0 ? (duckdb::idx_t)growth : 0;
+	if (target > reserved) {
+		try {
+			buffer_manager.ReserveMemory(target - reserved);
+		} catch (duckdb::OutOfMemoryException &e) {
+			throw duckdb::OutOfMemoryException(
+			    "Python objects created by this table function use %s, more than memory_limit allows: %s",
+			    duckdb::StringUtil::BytesToHumanReadableString(target), e.what());
+		}
+	} else if (target < reserved) {
+		buffer_manager.FreeReservedMemory(reserved - target);
+	}
+	reserved = target;
+}
+
+} // namespace pyudf
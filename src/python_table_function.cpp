@@ -153,14 +153,131 @@ std::vector<PyObject *> PythonTableFunction::pycolumn_types(PyObject *args, PyOb
 	return columnTypes;
 }
 
+std::vector<duckdb::LogicalType> PythonTableFunction::pyduckdb_types(PyObject *args, PyObject *kwargs) {
+	std::vector<duckdb::LogicalType> columnTypes;
+	PyObject *method = PyObject_GetAttrString(function, "column_duckdb_types");
+	if (!method) {
+		// Older versions of the decorator don't provide this
+		PyErr_Clear();
+		return columnTypes;
+	}
+	PyObject *result = PyCallable_Check(method) ? PyObject_Call(method, args, kwargs) : nullptr;
+	Py_DECREF(method);
+	if (!result) {
+		PyErr_Clear();
+		return columnTypes;
+	}
+	if (PyList_Check(result)) {
+		for (Py_ssize_t i = 0; i < PyList_Size(result); ++i) {
+			PyObject *listItem = PyList_GetItem(result, i);
+			if (!PyUnicode_Check(listItem)) {
+				columnTypes.clear();
+				break;
+			}
+			columnTypes.push_back(duckdb::TransformStringToLogicalType(Unicode_AsUTF8(listItem)));
+		}
+	}
+	Py_DECREF(result);
+	return columnTypes;
+}
+
+// Distinct argument lists whose schemas are kept, the oldest is evicted to make room for another
+static const size_t MAX_CACHED_SCHEMAS = 256;
+
+// Whether 'value' has a repr() that identifies it by value. Objects using object.__repr__ show
+// their address instead, so calls with them would never hit the cache.
+static bool HasValueRepr(PyObject *value) {
+	if (PyTuple_Check(value) || PyList_Check(value)) {
+		for (Py_ssize_t i = 0; i < PySequence_Size(value); i++) {
+			PyObject *item = PySequence_GetItem(value, i);
+			bool has_value_repr = HasValueRepr(item);
+			Py_DECREF(item);
+			if (!has_value_repr) {
+				return false;
+			}
+		}
+		return true;
+	} else if (PyDict_Check(value)) {
+		Py_ssize_t pos = 0;
+		PyObject *key, *item;
+		while (PyDict_Next(value, &pos, &key, &item)) {
+			if (!HasValueRepr(key) || !HasValueRepr(item)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	static PyObject *object_repr = PyObject_GetAttrString((PyObject *)&PyBaseObject_Type, "__repr__");
+	PyObject *type_repr = PyObject_GetAttrString((PyObject *)Py_TYPE(value), "__repr__");
+	if (!type_repr) {
+		PyErr_Clear();
+		return false;
+	}
+	bool has_value_repr = type_repr != object_repr;
+	Py_DECREF(type_repr);
+	return has_value_repr;
+}
+
+// The repr() of a call's arguments. Returns false if they can't be represented, or some are only
+// represented by their address, in which case the schema isn't cached.
+static bool ArgumentsKey(PyObject *args, PyObject *kwargs, std::string &key) {
+	if ((args && !HasValueRepr(args)) || (kwargs && !HasValueRepr(kwargs))) {
+		return false;
+	}
+	PyObject *call = PyTuple_Pack(2, args ? args : Py_None, kwargs ? kwargs : Py_None);
+	PyObject *repr = call ? PyObject_Repr(call) : nullptr;
+	Py_XDECREF(call);
+	if (!repr) {
+		PyErr_Clear();
+		return false;
+	}
+	key = Unicode_AsUTF8(repr);
+	Py_DECREF(repr);
+	return true;
+}
+
+PythonTableFunction::Schema PythonTableFunction::schema(PyObject *args, PyObject *kwargs) {
+	std::string key;
+	bool cacheable = ArgumentsKey(args, kwargs, key);
+	if (cacheable) {
+		auto entry = cached_schemas.find(key);
+		if (entry != cached_schemas.end()) {
+			return entry->second;
+		}
+	}
+	// Prefer DuckDB type names when the decorator provides them, as they describe nested
+	// annotations such as List[int] or dataclass fields, which the Python types alone do not
+	Schema schema;
+	schema.types = pyduckdb_types(args, kwargs);
+	if (schema.types.empty()) {
+		auto python_types = pycolumn_types(args, kwargs);
+		// todo: check for a Python error?
+		schema.types = PyTypesToLogicalTypes(python_types);
+		for (auto python_type : python_types) {
+			Py_DECREF(python_type);
+		}
+	}
+	schema.names = pycolumn_names(args, kwargs);
+	if (cacheable && !cached_schemas.count(key)) {
+		if (cached_order.size() >= MAX_CACHED_SCHEMAS) {
+			cached_schemas.erase(cached_order.front());
+			cached_order.pop_front();
+		}
+		cached_schemas[key] = schema;
+		cached_order.push_back(key);
+	}
+	return schema;
+}
+
 std::vector<duckdb::LogicalType> PythonTableFunction::column_types(PyObject *args, PyObject *kwargs) {
-	auto python_types = pycolumn_types(args, kwargs);
-	// todo: check for a Python error?
-	auto ddb_types = PyTypesToLogicalTypes(python_types);
-	return ddb_types;
+	return schema(args, kwargs).types;
 }
 
 std::vector<std::string> PythonTableFunction::column_names(PyObject *args, PyObject *kwargs) {
+	return schema(args, kwargs).names;
+}
+
+std::vector<std::string> PythonTableFunction::pycolumn_names(PyObject *args, PyObject *kwargs) {
 	std::vector<std::string> columnNames;
 
 	// Get the 'column_names' method
@@ -181,9 +298,7 @@ std::vector<std::string> PythonTableFunction::column_names(PyObject *args, PyObj
 
 				// Convert the list item to a C++ string
 				if (PyUnicode_Check(listItem)) {
-					const char *columnName = Unicode_AsUTF8(listItem);
-					columnNames.emplace_back(columnName);
-					// todo: free columnName?????
+					columnNames.emplace_back(Unicode_AsUTF8(listItem));
 				} else {
 					// todo: this will break something by leaving out a column name
 				}
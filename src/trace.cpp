@@ -0,0 +1,109 @@
+#include <trace.hpp>
+#include <log.hpp>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace pyudf {
+
+// Small sequential ids read better in trace viewers than hashed std::thread::ids
+static uint64_t TraceThreadId() {
+	static std::atomic<uint64_t> next_id {1};
+	thread_local uint64_t id = next_id++;
+	return id;
+}
+
+static void WriteJSONString(std::ofstream &out, const std::string &value) {
+	out << '"';
+	for (auto c : value) {
+		switch (c) {
+		case '"':
+			out << "\\\"";
+			break;
+		case '\\':
+			out << "\\\\";
+			break;
+		case '\n':
+			out << "\\n";
+			break;
+		default:
+			if ((unsigned char)c < 0x20) {
+				// Other control characters have no business in function names
+				out << ' ';
+			} else {
+				out << c;
+			}
+		}
+	}
+	out << '"';
+}
+
+Tracer &Tracer::Get() {
+	static Tracer tracer;
+	return tracer;
+}
+
+Tracer::~Tracer() {
+	Stop();
+}
+
+void Tracer::Start(const std::string &path) {
+	Stop();
+	if (path.empty()) {
+		return;
+	}
+	std::lock_guard<std::mutex> guard(lock);
+	out.open(path, std::ios::out | std::ios::trunc);
+	if (!out.is_open()) {
+		throw std::runtime_error("Failed to open trace file: " + path);
+	}
+	out << "[\n";
+	first_event = true;
+	enabled = true;
+	debug("Tracing to " + path);
+}
+
+void Tracer::Stop() {
+	std::lock_guard<std::mutex> guard(lock);
+	enabled = false;
+	if (out.is_open()) {
+		out << "\n]\n";
+		out.close();
+	}
+}
+
+void Tracer::Record(const char *name, const std::string &function, uint64_t start_ns, uint64_t end_ns,
+                    const std::vector<std::pair<const char *, uint64_t>> &args) {
+	if (!Enabled()) {
+		return;
+	}
+	auto tid = TraceThreadId();
+	std::lock_guard<std::mutex> guard(lock);
+	// Tracing may have been stopped while we waited for the lock
+	if (!out.is_open()) {
+		return;
+	}
+	if (!first_event) {
+		out << ",\n";
+	}
+	first_event = false;
+	// Complete ("X") events, timestamps in microseconds
+	out << "{\"name\":\"" << name << "\",\"cat\":\"pytables\",\"ph\":\"X\",\"pid\":" << getpid()
+	    << ",\"tid\":" << tid << ",\"ts\":" << start_ns / 1000 << '.' << (start_ns % 1000) / 100
+	    << ",\"dur\":" << (end_ns - start_ns) / 1000 << '.' << ((end_ns - start_ns) % 1000) / 100 << ",\"args\":{";
+	bool first_arg = true;
+	if (!function.empty()) {
+		out << "\"function\":";
+		WriteJSONString(out, function);
+		first_arg = false;
+	}
+	for (auto &arg : args) {
+		if (!first_arg) {
+			out << ',';
+		}
+		first_arg = false;
+		out << '"' << arg.first << "\":" << arg.second;
+	}
+	out << "}}";
+}
+
+} // namespace pyudf
@@ -1,5 +1,12 @@
 
-from typing import Iterable, Tuple
+import asyncio
+import datetime
+import decimal
+import sys
+import time
+import uuid
+from dataclasses import dataclass
+from typing import AsyncIterator, Iterable, Iterator, List, NamedTuple, Optional, Tuple, TypedDict
 
 # Scalar Functions
 def reverse(input):
@@ -83,6 +90,299 @@ def screaming_in_the_void():
     """Example function with no arguments for testing"""
     return table("foo bar")
 
+def type_name(value):
+    """Reports the Python type a DuckDB value was converted to, along with its value"""
+    return f"{type(value).__name__}:{value}"
+
+def grow(values):
+    """Mutates its list or dict argument, which must not be seen by the next row"""
+    if isinstance(values, dict):
+        values["extra"] = 0
+    else:
+        values.append(0)
+    return str(len(values))
+
+def typed_values():
+    """A single row exercising each of the natively supported types"""
+    yield (
+        True,
+        2 ** 40,
+        2 ** 100,
+        decimal.Decimal("12.34"),
+        datetime.date(2023, 1, 2),
+        datetime.datetime(2023, 1, 2, 3, 4, 5, 600000),
+        datetime.time(3, 4, 5),
+        datetime.timedelta(days=1, seconds=2),
+        b"raw bytes",
+        uuid.UUID("6f1d9f2c-2a4e-4c1a-9d3b-0c5b1e7f8a90"),
+        [1, 2, 3],
+        {"name": "duck", "legs": 2},
+        {"a": 1, "b": 2},
+        )
+
+def mixed_types():
+    """Rows whose values need promoting to a common type"""
+    yield (1, 1, None, datetime.date(2023, 1, 2), "a", [1])
+    yield (2, 2 ** 40, None, datetime.datetime(2023, 1, 2, 3, 4, 5), 2, [None, 2.5])
+    yield (3, 3, None, None, "c", [])
+
+def mixed_decimals():
+    """Decimals that are detected as DOUBLE: alongside a float, too wide for a DECIMAL, and NaN"""
+    yield (decimal.Decimal("1.5"), decimal.Decimal("1" * 40), decimal.Decimal("NaN"))
+    yield (2.25, decimal.Decimal("2"), decimal.Decimal("3.5"))
+
+def nested_lists():
+    yield ([[1, 2], [], None],)
+    yield (None,)
+    yield ([[3]],)
+
+class Point(NamedTuple):
+    x: float
+    y: float
+
+@dataclass
+class Shape:
+    name: str
+    points: List[Point]
+    area: Optional[float] = None
+
+@dataclass(**({'slots': True} if sys.version_info >= (3, 10) else {}))
+class CharAt:
+    index: int
+    char: str
+
+class CharRecord(TypedDict):
+    index: int
+    char: str
+
+def shapes() -> Iterator[Shape]:
+    yield Shape("line", [Point(0, 0), Point(1, 1)])
+    yield Shape("square", [Point(0, 0), Point(0, 1), Point(1, 1), Point(1, 0)], 1.0)
+
+def index_chars_dataclass(input) -> Iterator[CharAt]:
+    for i, c in enumerate(input):
+        yield CharAt(i, c)
+
+def index_chars_namedtuple(input) -> Iterator[Point]:
+    for i, c in enumerate(input):
+        yield Point(i, ord(c))
+
+def index_chars_typeddict(input) -> List[CharRecord]:
+    return [{"char": c, "index": i} for i, c in enumerate(input)]
+
+def index_chars_dicts(input):
+    """Unannotated dict rows, the columns are detected from their keys"""
+    for i, c in enumerate(input):
+        yield {"index": i, "char": c}
+
+def repeated_strings(rows, fresh):
+    """A few distinct values repeated, optionally as new but equal str objects, with some NULLs"""
+    regions = ["us-east-1", "eu-west-1", "a region with a long name", None]
+    for i in range(int(rows)):
+        region = regions[i % len(regions)]
+        if fresh and region is not None:
+            region = "".join(list(region))
+        yield (i, region)
+
+def strings_then_numbers(rows):
+    """Repeated strings until halfway, then numbers"""
+    for i in range(int(rows)):
+        yield ("text" if i < int(rows) // 2 else i % 3,)
+
+def distinct_strings(rows):
+    for i in range(int(rows)):
+        yield (f"value {i}",)
+
+def objects_under(prefix, delay=0):
+    """Stands in for listing a bucket, sleeping like a network call would (which releases the GIL)"""
+    time.sleep(float(delay))
+    for i in range(3):
+        yield (f"{prefix}/object-{i}", i * 100)
+
+class _Cursor:
+    """Same protocol as ducktables.Cursor, which this module doesn't import"""
+    def __init__(self, value):
+        self.__ducktables_cursor__ = value
+
+def events_since(total, cursor=None):
+    """Stands in for an append only source of 'total' events, returning those after the cursor"""
+    start = 0 if cursor is None else cursor["last_id"] + 1
+    for i in range(start, int(total)):
+        yield (i, f"event {i}")
+    if start < int(total):
+        yield _Cursor({"last_id": int(total) - 1})
+
+def unsaveable_cursor(cursor=None):
+    yield (1,)
+    yield _Cursor(object())
+
+def trace_event_names(path) -> Iterator[Tuple[str, str]]:
+    """The distinct (name, function) pairs of a Chrome trace written by pytables_trace_file"""
+    import json
+    with open(path) as trace:
+        events = json.load(trace)
+    for name, function in sorted({(e["name"], e["args"].get("function", "")) for e in events}):
+        yield (name, function)
+
+# Held at module level so the memory outlives the generator, like a cache of API responses
+_hoard = []
+
+def hoard_memory(megabytes):
+    """Yields one row per megabyte it holds on to"""
+    for i in range(int(megabytes)):
+        _hoard.append(bytes(1024 * 1024))
+        yield (len(_hoard),)
+
+def release_memory():
+    _hoard.clear()
+
+def busy_wait(seconds):
+    """Spins for 'seconds', staying in Python so it can be interrupted"""
+    end = time.monotonic() + float(seconds)
+    while time.monotonic() < end:
+        pass
+    return "finished"
+
+def slow_rows(rows, seconds_per_row):
+    for i in range(int(rows)):
+        busy_wait(seconds_per_row)
+        yield (i,)
+
+# How many times each of the counted functions ran, for checking what DuckDB optimized away
+_call_counts = {}
+
+def counted_square(x):
+    _call_counts["counted_square"] = _call_counts.get("counted_square", 0) + 1
+    # pycall returns VARCHAR, which only holds str results
+    return str(int(x) ** 2)
+
+# Same as decorating with @ducktables.deterministic, without depending on the package
+counted_square.__ducktables_deterministic__ = True
+
+def counted_volatile_square(x):
+    _call_counts["counted_volatile_square"] = _call_counts.get("counted_volatile_square", 0) + 1
+    return str(int(x) ** 2)
+
+# Same as decorating with @ducktables.volatile
+counted_volatile_square.__ducktables_deterministic__ = False
+
+def counted_undeclared_square(x):
+    _call_counts["counted_undeclared_square"] = _call_counts.get("counted_undeclared_square", 0) + 1
+    return str(int(x) ** 2)
+
+def square(x):
+    return int(x) ** 2
+
+def call_count(name):
+    return str(_call_counts.get(name, 0))
+
+def reset_call_counts():
+    _call_counts.clear()
+
+class WordMatcher:
+    """Class based function, the pattern is compiled once per thread in setup()"""
+
+    def setup(self):
+        import re
+        self.pattern = re.compile(r"^[a-z]+$")
+        _call_counts["setup"] = _call_counts.get("setup", 0) + 1
+
+    def __call__(self, value):
+        return str(bool(self.pattern.match(value)))
+
+    def teardown(self):
+        _call_counts["teardown"] = _call_counts.get("teardown", 0) + 1
+
+class BatchSquare:
+    """Class based function that processes a chunk at a time"""
+
+    def setup(self):
+        pass
+
+    def process_batch(self, values):
+        _call_counts["batches"] = _call_counts.get("batches", 0) + 1
+        return [None if v is None else str(v * v) for v in values]
+
+# Batches received by the COPY ... (FORMAT python) targets below
+_sunk = []
+
+def collect_batch(batch):
+    """Function sink, each batch is a dict of column lists"""
+    _sunk.append(batch)
+    _call_counts["sink_batches"] = _call_counts.get("sink_batches", 0) + 1
+
+def sunk_rows() -> Iterator[Tuple[int, str]]:
+    """The (id, name) rows received by the sinks, in the order received"""
+    for batch in _sunk:
+        if hasattr(batch, "to_pydict"):
+            batch = batch.to_pydict()
+        yield from zip(batch["id"], batch["name"])
+
+def reset_sunk():
+    _sunk.clear()
+    _call_counts.clear()
+
+class CollectingSink:
+    """Sink class, an instance per thread"""
+
+    def setup(self):
+        _call_counts["setup"] = _call_counts.get("setup", 0) + 1
+
+    def write(self, batch):
+        _sunk.append(batch)
+
+    def flush(self):
+        _call_counts["flush"] = _call_counts.get("flush", 0) + 1
+
+    @classmethod
+    def finalize(cls):
+        _call_counts["finalize"] = _call_counts.get("finalize", 0) + 1
+
+def failing_sink(batch):
+    raise ValueError("the queue is full")
+
+# Async table functions
+async def async_rows(rows) -> AsyncIterator[Point]:
+    for i in range(int(rows)):
+        # Hands control back to the event loop, like awaiting a response would
+        await asyncio.sleep(0)
+        yield Point(i, i * i)
+
+async def async_untyped_rows(rows):
+    for i in range(int(rows)):
+        yield (f"row {i}", i)
+
+async def async_throws_exception(rows):
+    for i in range(int(rows)):
+        yield (i,)
+    raise ValueError("the connection was reset")
+
+async def async_sleepy_rows(rows, seconds_per_row):
+    for i in range(int(rows)):
+        await asyncio.sleep(float(seconds_per_row))
+        yield (i,)
+
+# Most fetches awaited at once by the last async_fetches() scan
+_fetches = {"in_flight": 0, "peak": 0}
+
+async def _fetch(i, seconds):
+    _fetches["in_flight"] += 1
+    _fetches["peak"] = max(_fetches["peak"], _fetches["in_flight"])
+    try:
+        await asyncio.sleep(float(seconds))
+    finally:
+        _fetches["in_flight"] -= 1
+    return (i, f"response {i}")
+
+async def async_fetches(requests, seconds):
+    """Stands in for a client sending 'requests' requests, yielding each one's response to await"""
+    _fetches["peak"] = 0
+    for i in range(int(requests)):
+        yield _fetch(i, seconds)
+
+def async_fetches_peak():
+    return str(_fetches["peak"])
+
 import unittest
 
 class TestUdfs(unittest.TestCase):